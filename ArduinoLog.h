@@ -15,7 +15,6 @@
 #ifndef LOGGING_H
 #define LOGGING_H
 #include <inttypes.h>
-#include <stdarg.h>
 #if defined(ARDUINO) && ARDUINO >= 100
 #include "Arduino.h"
 #include "Ethernet.h"
@@ -23,14 +22,176 @@
 #include "WProgram.h"
 #endif
 typedef void (*printfunction)(Print*);
+typedef void (*formatfunction)(Print*, const void*);
+typedef unsigned long (*timefunction)();
 
 //#include <stdint.h>
 //#include <stddef.h>
+// *************************************************************************
+//  The library is header only. Everything below the IMPLEMENTATION banner
+//  is inline, so the header can be included from any number of files,
+//  which share one Log instance; the configuration macros must then be
+//  the same in all of them. LOG_INLINE marks the level check of the log
+//  calls, which is worth inlining at every call site, LOG_NOINLINE the
+//  formatting behind it, and LOG_COLD the setup functions, which the
+//  compiler optimizes for size and places apart from the hot code.
+// ************************************************************************
+#if defined(__GNUC__)
+#define LOG_INLINE   inline __attribute__((always_inline))
+#define LOG_NOINLINE __attribute__((noinline))
+#define LOG_COLD     __attribute__((cold))
+#define LOG_UNUSED   __attribute__((unused))
+#else
+#define LOG_INLINE   inline
+#define LOG_NOINLINE
+#define LOG_COLD
+#define LOG_UNUSED
+#endif
+
 // *************************************************************************
 //  Uncomment line below to fully disable logging, and reduce project size
 // ************************************************************************
 //#define DISABLE_LOGGING
 
+// *************************************************************************
+//  Size of the per-instance staging buffer each log record is assembled in
+//  before it is written to the output in one go. Longer records are
+//  flushed in chunks of this size. Define before including to change it.
+// ************************************************************************
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE 64
+#endif
+
+// *************************************************************************
+//  Define to a power of two to enable asynchronous logging: records are
+//  queued in a ring buffer of this many bytes and written to the output
+//  later by Log.drain() (or a drain task on ESP32), instead of blocking the
+//  caller. e.g. #define LOG_ASYNC_BUFFER_SIZE 512
+// ************************************************************************
+//#define LOG_ASYNC_BUFFER_SIZE 512
+
+// *************************************************************************
+//  Maximum number of outputs (sinks) a Logging instance can write to, each
+//  with its own level. Define before including to change it (1 to 8).
+// ************************************************************************
+#ifndef LOG_MAX_OUTPUTS
+#define LOG_MAX_OUTPUTS 2
+#endif
+
+// *************************************************************************
+//  Define to the number of tags (modules) that get their own run-time log
+//  level through setTagLevel(). Tag ids go from 0 to LOG_MAX_TAGS - 1.
+//  e.g. #define LOG_MAX_TAGS 8
+// ************************************************************************
+//#define LOG_MAX_TAGS 8
+
+// *************************************************************************
+//  Define to the number of format specifiers an application can add with
+//  Log.addSpecifier(), to print its own types, e.g. %M for a MAC address.
+//  e.g. #define LOG_MAX_SPECIFIERS 4
+// ************************************************************************
+//#define LOG_MAX_SPECIFIERS 4
+
+// *************************************************************************
+//  Uncomment (or define before including) to emit compact binary records
+//  instead of text: the format string address, the level, a timestamp and
+//  the raw argument bytes. Decode them on the host with
+//  extras/decoder/arduinolog_decode.py and the sketch's .elf file.
+// ************************************************************************
+//#define LOG_BINARY_FORMAT
+
+// *************************************************************************
+//  Uncomment (or define before including) to collect statistics about the
+//  logger itself: records per level, bytes written and the time spent
+//  formatting and writing. Read them with Log.getStats().
+// ************************************************************************
+//#define LOG_ENABLE_STATS
+
+// *************************************************************************
+//  Uncomment (or define before including) to log safely from several tasks
+//  or cores (ESP32, RP2040, FreeRTOS). Each call formats its record into a
+//  buffer on the caller's stack and only takes a lock to hand the finished
+//  record to the output, or to the ring buffer with LOG_ASYNC_BUFFER_SIZE,
+//  which also enables Log.logFromISR().
+// ************************************************************************
+//#define LOG_THREAD_SAFE
+
+// *************************************************************************
+//  With LOG_FLASH_FORMAT set to 1, the LOG_xxx macros below store their
+//  format string in flash memory, as if it were wrapped in F(), so log
+//  text costs no SRAM. The format must then be a string literal. Defaults
+//  to 1 on AVR, where string literals are otherwise copied to SRAM.
+// ************************************************************************
+#ifndef LOG_FLASH_FORMAT
+#if defined(__AVR__)
+#define LOG_FLASH_FORMAT 1
+#else
+#define LOG_FLASH_FORMAT 0
+#endif
+#endif
+
+// *************************************************************************
+//  Define to the number of call sites (format strings) whose messages are
+//  rate limited: every call site gets a token bucket, messages beyond it
+//  are suppressed and summarized later. Tune with Log.setRateLimit().
+//  e.g. #define LOG_RATE_LIMIT 8
+// ************************************************************************
+//#define LOG_RATE_LIMIT 8
+
+// *************************************************************************
+//  Define to log only a sample of the records of chosen levels, e.g. every
+//  100th TRACE record of a 1 kHz loop. Set the rates with
+//  Log.setSampleRate(); the check comes right after the level check.
+// ************************************************************************
+//#define LOG_SAMPLING
+
+// *************************************************************************
+//  Define to the size of a RAM buffer that keeps the latest output across
+//  a reset (watchdog, crash), for Log.setFlightRecorder() and
+//  Log.dumpRetained(). The buffer lives in a section that the startup
+//  code does not clear; LOG_NOINIT selects it and can be redefined for
+//  other linker scripts.
+//  e.g. #define LOG_RETAINED_SIZE 1024
+// ************************************************************************
+//#define LOG_RETAINED_SIZE 1024
+#ifndef LOG_NOINIT
+#if defined(ESP32)
+#define LOG_NOINIT __NOINIT_ATTR
+#elif defined(ARDUINO_ARCH_RP2040)
+#define LOG_NOINIT __attribute__((section(".uninitialized_data")))
+#else
+#define LOG_NOINIT __attribute__((section(".noinit")))
+#endif
+#endif
+
+// *************************************************************************
+//  Number of fractional bits of the fixed point values printed with %Q,
+//  e.g. 16 for Q16.16 or 8 for Q7.8 (1 to 28). Define before including.
+// ************************************************************************
+#ifndef LOG_FIXED_POINT_BITS
+#define LOG_FIXED_POINT_BITS 16
+#endif
+
+// *************************************************************************
+//  Define to the number of bytes kept for the context of the open
+//  LogScopes, which is rendered once and copied into every record, and
+//  set LOG_SCOPE_DEPTH to the number of scopes that can be nested
+//  (default 4). Without it LogScope does nothing. e.g.
+//  #define LOG_SCOPE_SIZE 32
+// ************************************************************************
+//#define LOG_SCOPE_SIZE 32
+#if defined(LOG_SCOPE_SIZE) && !defined(LOG_SCOPE_DEPTH)
+#define LOG_SCOPE_DEPTH 4
+#endif
+
+// *************************************************************************
+//  Number of bytes per row printed by Log.hexdump(). Define before
+//  including to change it (1 to 64).
+// ************************************************************************
+#ifndef LOG_HEXDUMP_WIDTH
+#define LOG_HEXDUMP_WIDTH 16
+#endif
+
 #define LOG_LEVEL_SILENT  0
 #define LOG_LEVEL_FATAL   1
 #define LOG_LEVEL_ERROR   2
@@ -39,9 +200,45 @@ typedef void (*printfunction)(Print*);
 #define LOG_LEVEL_TRACE   5
 #define LOG_LEVEL_VERBOSE 6
 
+#define LOG_LEVEL_INHERIT -1
+
+// *************************************************************************
+//  Highest log level compiled into the program. Calls above this level are
+//  removed at compile time (code, format strings and, when the LOG_xxx
+//  macros below are used, argument evaluation). Define before including,
+//  e.g. #define LOG_LEVEL_MAX LOG_LEVEL_WARNING
+// ************************************************************************
+#ifndef LOG_LEVEL_MAX
+#define LOG_LEVEL_MAX LOG_LEVEL_VERBOSE
+#endif
+
+#define LOG_TIMESTAMP_NONE   0
+#define LOG_TIMESTAMP_MILLIS 1
+#define LOG_TIMESTAMP_MICROS 2
+#define LOG_TIMESTAMP_UPTIME 3
+#define LOG_TIMESTAMP_RTC    4
+
+#define LOG_RECORD_TEXT   0
+#define LOG_RECORD_JSON   1
+#define LOG_RECORD_LOGFMT 2
+
+#define LOG_OVERFLOW_DROP_NEWEST 0
+#define LOG_OVERFLOW_DROP_OLDEST 1
+#define LOG_OVERFLOW_BLOCK       2
+
 #define CR "\n"
 #define LOGGING_VERSION 1_0_3
 
+#if defined(__AVR__)
+#define LOG_MEMORY_BARRIER() __asm__ __volatile__ ("" ::: "memory")
+#else
+#define LOG_MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+template <class Config> class BasicLogging;
+struct LogConfig;
+typedef BasicLogging<LogConfig> Logging;
+
 /**
    Logging is a helper class to output informations over
    RS232. If you know log4j or log4net, this logging class
@@ -57,15 +254,35 @@ typedef void (*printfunction)(Print*);
    ---- Wildcards
 
    %s   replace with an string (char*)
+   %S   replace with a String or any Printable object
+   %P   replace with a string from flash memory
+   %I   replace with an IPAddress
    %c   replace with an character
    %d   replace with an integer value
    %l   replace with an long value
+   %u   replace with an unsigned long value
    %x   replace and convert integer value into hex
    %X   like %x but combine with 0x123AB
    %b   replace and convert integer value into binary
    %B   like %x but combine with 0b10100011
    %t   replace and convert boolean value into "t" or "f"
    %T   like %t but convert into "true" or "false"
+   %D   replace with a float or double value
+   %F   like %D
+   %Q   replace with a fixed point integer, LOG_FIXED_POINT_BITS fraction bits
+   %%   replace with a percent sign
+
+   Arguments are passed to the printers by type, so the specifier only
+   selects the representation: e.g. %x works for any integer type, and a
+   long passed to %d is printed in full.
+
+   The integer wildcards (%d %l %u %x %X %b %B) take an optional field
+   width, right aligned with spaces or, with a leading 0, with zeros:
+   "%08x" prints 0000BEEF, "%5d" prints "   42". The 0x and 0b prefixes
+   are not counted in the width.
+
+   %D %F and %Q take a width and a precision of 0 to 9 digits, 2 if none
+   is given: "%.3F" prints 3.142, "%8.1F" prints "     3.1".
 
    ---- Loglevels
 
@@ -78,474 +295,5469 @@ typedef void (*printfunction)(Print*);
    6 - LOG_LEVEL_VERBOSE    all
 */
 
-class Logging
+/**
+   LogBuffer is the staging area a log record is built in. Characters are
+   collected in a fixed-size array and handed to the output with a single
+   Print::write(const uint8_t*, size_t) call, instead of one virtual write()
+   per character. When the buffer fills up it is flushed and reused, so
+   records of any length can be logged.
+*/
+class LogBuffer : public Print
 {
   public:
+    LogBuffer() : _output(NULL), _length(0), _flushed(0), _escape(false), _newlines(0) {}
+
     /**
-       default Constructor
-    */
-    Logging()
-#ifndef DISABLE_LOGGING
-      : _level(LOG_LEVEL_SILENT),
-        _showLevel(true),
-        _logOutput(NULL)
-#endif
-    {
+       Sets the Print object the buffered characters are written to.
 
-    }
+       \param output - pointer to the Print object
+       \return void
+    */
+    void setOutput(Print *output) { _output = output; }
 
     /**
-       Initializing, must be called as first. Note that if you use
-       this variant of Init, you need to initialize the baud rate
-       yourself, if printer happens to be a serial port.
+       Marks the start of a new record.
 
-       \param level - logging levels <= this will be logged.
-       \param printer - place that logging output will be sent to.
        \return void
-
     */
-    void begin(int level, Print *output, bool showLevel = true);
+    void beginRecord()
+    {
+      _flushed = 0;
+      _escape = false;
+      _newlines = 0;
+    }
 
     /**
-       Set the log level.
+       Turns escaping for a quoted JSON or logfmt string on or off. While
+       it is on, quotes, backslashes and control characters are appended
+       as escape sequences. Line breaks are held back and only appended
+       when more text follows, so a trailing CR of a message is dropped;
+       carriage returns are dropped.
 
-       \param level - The new log level.
+       \param escape - true to escape the characters appended from now on
        \return void
     */
-    void setLevel(int level);
+    void setEscape(bool escape)
+    {
+      _escape = escape;
+      _newlines = 0;
+    }
 
     /**
-       Get the log level.
+       Number of characters appended since beginRecord().
 
-       \return The current log level.
+       \return the position in the current record
     */
-    int getLevel() const;
+    size_t position() const { return _flushed + _length; }
 
     /**
-       Set whether to show the log level.
+       Appends a single character, flushing first if the buffer is full.
 
-       \param showLevel - true if the log level should be shown for each log
-                          false otherwise.
+       \param c - the character to append
        \return void
     */
-    void setShowLevel(bool showLevel);
+    void append(char c)
+    {
+      if (_escape)
+      {
+        appendEscaped(c);
+        return;
+      }
+      appendRaw(c);
+    }
 
     /**
-       Get whether the log level is shown during logging
+       Appends a block of characters, flushing as often as needed.
 
-       \return true if the log level is be shown for each log
-               false otherwise.
+       \param s - characters to append
+       \param n - number of characters
+       \return void
     */
-    bool getShowLevel() const;
+    void append(const char *s, size_t n);
 
     /**
-       Sets a function to be called before each log command.
+       Appends a zero terminated string from program memory.
 
-       \param f - The function to be called
+       \param s - the string, e.g. PSTR("text") or a PROGMEM array
        \return void
     */
-    void setPrefix(printfunction f);
+    void append_P(const char *s);
 
     /**
-       Sets a function to be called after each log command.
+       Appends an unsigned value in decimal. Two digits are produced per
+       division, taken from a table of digit pairs, and values that fit
+       16 bits are converted with 16 bit arithmetic.
 
-       \param f - The function to be called
+       \param value - the value to append
+       \param width - minimum number of characters, 0 for none
+       \param pad - character used to fill up to the width
        \return void
     */
-    void setSuffix(printfunction f);
+    void appendUnsigned(unsigned long value, uint8_t width = 0, char pad = ' ');
 
     /**
-       Sets an output handler for the Log entires.
+       Appends a signed value in decimal. With zero padding the sign is
+       placed before the zeros, e.g. -0042.
 
-       \param output - pointer to the Print object
+       \param value - the value to append
+       \param width - minimum number of characters including the sign
+       \param pad - character used to fill up to the width
        \return void
     */
-    void setOutput( Print *output );
+    void appendSigned(long value, uint8_t width = 0, char pad = ' ');
+
     /**
-       Output a fatal error message. Output message contains
-       F: followed by original message
-       Fatal error messages are printed out at
-       loglevels >= LOG_LEVEL_FATAL
+       Appends a value in upper case hexadecimal, using shifts and masks.
 
-       \param msg format string to output
-       \param ... any number of variables
+       \param value - the value to append
+       \param width - minimum number of digits, 0 for none
+       \param pad - character used to fill up to the width
        \return void
     */
-    template <class T, typename... Args> void fatal(T msg, Args... args)
-    {
-#ifndef DISABLE_LOGGING
-      printLevel(LOG_LEVEL_FATAL, msg, args...);
-#endif
-    }
+    void appendHex(unsigned long value, uint8_t width = 0, char pad = ' ');
 
     /**
-       Output an error message. Output message contains
-       E: followed by original message
-       Error messages are printed out at
-       loglevels >= LOG_LEVEL_ERROR
+       Appends a value in binary, using shifts and masks.
 
-       \param msg format string to output
-       \param ... any number of variables
+       \param value - the value to append
+       \param width - minimum number of digits, 0 for none
+       \param pad - character used to fill up to the width
        \return void
     */
-    template <class T, typename... Args> void error(T msg, Args... args) {
-#ifndef DISABLE_LOGGING
-      printLevel(LOG_LEVEL_ERROR, msg, args...);
-#endif
-    }
+    void appendBinary(unsigned long value, uint8_t width = 0, char pad = ' ');
 
     /**
-       Output a warning message. Output message contains
-       W: followed by original message
-       Warning messages are printed out at
-       loglevels >= LOG_LEVEL_WARNING
+       Appends a long long value. Values that fit in an unsigned long are
+       printed by the same code as appendUnsigned(), so only the digits
+       beyond that range cost 64 bit divisions.
 
-       \param msg format string to output
-       \param ... any number of variables
+       \param value - the magnitude of the value
+       \param base - 10, 16 or 2
+       \param width - minimum number of characters including the sign
+       \param pad - character used to fill up to the width
+       \param negative - true to print a minus sign
        \return void
     */
-    template <class T, typename... Args> void warning(T msg, Args...args)
-    {
-#ifndef DISABLE_LOGGING
-      printLevel(LOG_LEVEL_WARNING, msg, args...);
-#endif
-    }
+    void appendLongLong(unsigned long long value, uint8_t base, uint8_t width = 0, char pad = ' ', bool negative = false);
 
     /**
-       Output a notice message. Output message contains
-       N: followed by original message
-       Notice messages are printed out at
-       loglevels >= LOG_LEVEL_NOTICE
+       Appends a floating point value with a fixed number of decimals. The
+       value is scaled to integers with a single multiplication and then
+       printed with the decimal kernel, instead of one floating point
+       operation per digit. Prints nan, inf and, beyond the range of an
+       unsigned long, ovf, like Print::print(double).
 
-       \param msg format string to output
-       \param ... any number of variables
+       \param value - the value to append
+       \param precision - number of decimals, 0 to 9
+       \param width - minimum number of characters including sign and point
+       \param pad - character used to fill up to the width
        \return void
     */
-    template <class T, typename... Args> void notice(T msg, Args...args)
-    {
-#ifndef DISABLE_LOGGING
-      printLevel(LOG_LEVEL_NOTICE, msg, args...);
-#endif
-    }
+    void appendFloat(double value, uint8_t precision, uint8_t width = 0, char pad = ' ');
 
     /**
-       Output a trace message. Output message contains
-       N: followed by original message
-       Trace messages are printed out at
-       loglevels >= LOG_LEVEL_TRACE
+       Appends a fixed point value with a fixed number of decimals, using
+       integer arithmetic only.
 
-       \param msg format string to output
-       \param ... any number of variables
+       \param value - the value, scaled by 2 to the power of bits
+       \param bits - number of fraction bits, 1 to 28
+       \param negative - true if value is the magnitude of a negative number
+       \param precision - number of decimals, 0 to 9
+       \param width - minimum number of characters including sign and point
+       \param pad - character used to fill up to the width
        \return void
     */
-    template <class T, typename... Args> void trace(T msg, Args... args)
+    void appendFixed(unsigned long value, uint8_t bits, bool negative, uint8_t precision, uint8_t width = 0, char pad = ' ');
+
+    /**
+       Converts the low four bits of a value to an upper case hex digit.
+
+       \param nibble - the value, only bits 0 to 3 are used
+       \return the digit character
+    */
+    static char hexDigit(uint8_t nibble)
     {
-#ifndef DISABLE_LOGGING
-      printLevel(LOG_LEVEL_TRACE, msg, args...);
-#endif
+      nibble &= 0x0F;
+      return (char)(nibble < 10 ? '0' + nibble : 'A' - 10 + nibble);
     }
 
     /**
-       Output a verbose message. Output message contains
-       V: followed by original message
-       Debug messages are printed out at
-       loglevels >= LOG_LEVEL_VERBOSE
+       Writes the buffered characters to the output and empties the buffer.
 
-       \param msg format string to output
-       \param ... any number of variables
        \return void
     */
-    template <class T, typename... Args> void verbose(T msg, Args... args)
-    {
-#ifndef DISABLE_LOGGING
-      printLevel(LOG_LEVEL_VERBOSE, msg, args...);
-#endif
-    }
+    void flush();
 
-  private:
-    void print(const char *format, va_list args);
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *buffer, size_t size);
 
-    void print(const __FlashStringHelper *format, va_list args);
+    /**
+       Writes a value below 100 as two decimal digits in front of p.
 
-    void printFormat(const char format, va_list *args);
+       \param p - the position after the last digit
+       \param value - the value, 0 to 99
+       \return the position of the first digit
+    */
+    static char *writeDigitPair(char *p, uint8_t value);
 
-    template <class T> void printLevel(int level, T msg, ...)
+  private:
+    void appendRaw(char c)
     {
-#ifndef DISABLE_LOGGING
-      if (level > _level)
+      if (_length == LOG_BUFFER_SIZE)
       {
-        return;
+        flush();
       }
+      _buffer[_length++] = c;
+    }
 
-      if (_prefix != NULL)
-      {
-        _prefix(_logOutput);
-      }
+    void appendEscaped(char c);
 
-      if (_showLevel) {
-        static const char levels[] = "FEWNTV";
-        _logOutput->print(levels[level - 1]);
-        _logOutput->print(": ");
-      }
+    void appendNumber(unsigned long value, uint8_t base, uint8_t width, char pad, bool negative);
 
-      va_list args;
-      va_start(args, msg);
-      print(msg, args);
+    static char *writeNumber(char *p, unsigned long value, uint8_t base);
 
-      if (_suffix != NULL)
-      {
-        _suffix(_logOutput);
-      }
-#endif
-    }
+    void appendDigits(const char *p, size_t length, uint8_t width, char pad, bool negative);
 
-#ifndef DISABLE_LOGGING
-    int _level;
-    bool _showLevel;
-    Print* _logOutput;
+    void appendDecimal(unsigned long integer, unsigned long fraction, uint8_t precision, uint8_t width, char pad, bool negative);
 
-    printfunction _prefix = NULL;
-    printfunction _suffix = NULL;
-#endif
+    Print* _output;
+    size_t _length;
+    size_t _flushed;
+    bool _escape;
+    uint8_t _newlines;
+    char _buffer[LOG_BUFFER_SIZE];
 };
 
-#ifndef DISABLE_STATIC_LOG
-extern Logging Log;
-#endif  //  #ifndef DISABLE_STATIC_LOG
-#endif
+/**
+   LogTimestamp prints the built-in timestamp prefix selected with
+   Logging::setTimestamp(). The clock modes keep the rendered time in a
+   small cache: while records arrive within the same hour only the
+   seconds and minutes digits are advanced in place, and the complete
+   string, including the date, is rendered again only when the hour
+   changes.
+*/
+class LogTimestamp
+{
+  public:
+    LogTimestamp() : _mode(LOG_TIMESTAMP_NONE), _clock(NULL), _valid(false) {}
 
+    /**
+       Selects the timestamp format.
 
+       \param mode - one of the LOG_TIMESTAMP_xxx modes
+       \param clock - for LOG_TIMESTAMP_RTC, returns the Unix time in seconds
+       \return void
+    */
+    void setMode(uint8_t mode, timefunction clock);
 
+    /**
+       Returns the timestamp format, one of the LOG_TIMESTAMP_xxx modes.
+    */
+    uint8_t getMode() const { return _mode; }
 
+    /**
+       Appends the timestamp, if a mode is set.
 
+       \param buffer - the record buffer
+       \param padded - true to right align counters and add a separating
+                        space, false for the bare value
+       \return void
+    */
+    void print(LogBuffer &buffer, bool padded = true);
 
+    /**
+       Appends millis() as in LOG_TIMESTAMP_MILLIS, if a mode is set.
 
-// ==== IMPLEMENTATION =======================================================
-/*
-    _   ___ ___  _   _ ___ _  _  ___  _    ___   ___
-   /_\ | _ \   \| | | |_ _| \| |/ _ \| |  / _ \ / __|
-  / _ \|   / |) | |_| || || .` | (_) | |_| (_) | (_ |
-  /_/ \_\_|_\___/ \___/|___|_|\_|\___/|____\___/ \___|
+       \param buffer - the record buffer
+       \param padded - as for print()
+       \return void
+    */
+    void printMillis(LogBuffer &buffer, bool padded = true);
 
-  Log library for Arduino
-  version 1.0.3
-  https://github.com/thijse/Arduino-Log
+    /**
+       Returns true if the mode keeps a cached clock text, which print()
+       updates.
+    */
+    bool isCached() const { return _mode == LOG_TIMESTAMP_UPTIME || _mode == LOG_TIMESTAMP_RTC; }
 
-  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+  private:
+    void advance(uint8_t seconds);
 
-  Permission is hereby  granted, free of charge, to any  person obtaining a copy
-  of this software and associated  documentation files (the "Software"), to deal
-  in the Software  without restriction, including without  limitation the rights
-  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
-  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
-  furnished to do so, subject to the following conditions:
+    void render();
 
-  The above copyright notice and this permission notice shall be included in all
-  copies or substantial portions of the Software.
+    uint8_t _mode;
+    timefunction _clock;
+    bool _valid;
+    uint8_t _minute;
+    uint8_t _second;
+    uint8_t _length;
+    unsigned long _seconds;      // total seconds of the cached time
+    unsigned long _secondStart;  // millis() at the start of that second
+    char _text[sizeof("YYYY-MM-DD HH:MM:SS")];
+};
 
-  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
-  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
-  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
-  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
-  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
-  SOFTWARE.
+#ifdef LOG_RATE_LIMIT
+/**
+   LogRateLimiter keeps a token bucket per call site, keyed by the address
+   of the format string. A call site may log a burst of messages at once
+   and then one message per interval; messages beyond that are counted
+   instead of printed. As soon as a suppressing call site gets a token
+   again, or has one when another call site logs, its count is handed out
+   by takeSummary(). When the table is full, the call site whose bucket
+   was refilled longest ago is replaced.
+*/
+class LogRateLimiter
+{
+  public:
+    LogRateLimiter();
+
+    /**
+       Sets the limit for every call site.
+
+       \param burst - messages a call site may log at once, 0 for no limit
+       \param interval - milliseconds after which a call site gets one more
+       \return void
+    */
+    void setLimit(uint8_t burst, uint16_t interval);
+
+    /**
+       Takes a token for the call site of a message.
+
+       \param format - the format string of the message
+       \param flash - true if the format string is in program memory
+       \param level - the level of the message
+       \return true if the message may be logged, false to suppress it
+    */
+    bool allow(const char *format, bool flash, uint8_t level);
+
+    /**
+       Returns true if some call site has suppressed messages.
+    */
+    bool hasPending() const { return _pending != 0; }
+
+    /**
+       Finds a call site whose suppressed messages are due for a summary,
+       and clears its count.
+
+       \param format - set to the format string of the call site
+       \param flash - set to true if it is in program memory
+       \param level - set to the level of its last message
+       \param count - set to the number of suppressed messages
+       \return false if there is no such call site
+    */
+    bool takeSummary(const char *&format, bool &flash, uint8_t &level, uint16_t &count);
+
+  private:
+    struct Entry
+    {
+      const char *format;
+      unsigned long refilled;   // millis() of the last token refill
+      uint16_t suppressed;
+      uint16_t summary;         // suppressed messages due for a summary
+      uint8_t tokens;
+      uint8_t level;
+      bool flash;
+    };
+
+    void refill(Entry &entry, unsigned long now);
+
+    static void moveToSummary(Entry &entry);
+
+    Entry _entries[LOG_RATE_LIMIT];
+    uint8_t _burst;
+    uint16_t _interval;
+    uint8_t _pending;         // entries with suppressed messages
+};
+
+/**
+   LogSummaryText prints the format string of a call site in its summary,
+   without the trailing line ending; the summary ends its own line.
+*/
+class LogSummaryText : public Printable
+{
+  public:
+    LogSummaryText(const char *format, bool flash) : _format(format), _flash(flash) {}
+
+    virtual size_t printTo(Print &output) const;
+
+  private:
+    char at(size_t i) const { return _flash ? pgm_read_byte(_format + i) : _format[i]; }
+
+    const char *_format;
+    bool _flash;
+};
+#endif
+
+/**
+   LogTag identifies the module a message comes from. With LOG_MAX_TAGS
+   defined, each tag id has its own log level. The optional name is
+   printed after the level, e.g. "N: wifi: connected".
+
+       const LogTag TAG_WIFI(0, "wifi");
+       Log.notice(TAG_WIFI, "connected to %s" CR, ssid);
+*/
+class LogTag
+{
+  public:
+    constexpr LogTag(uint8_t id, const char *name = NULL) : _id(id), _name(name) {}
+
+    constexpr uint8_t id() const { return _id; }
+
+    constexpr const char *name() const { return _name; }
+
+  private:
+    uint8_t _id;
+    const char *_name;
+};
+
+/**
+   LogField names a log argument. It is printed like the plain value where
+   the message has a wildcard for it, and with LOG_RECORD_JSON or
+   LOG_RECORD_LOGFMT it is also added to the record as a field of its own.
+   Fields after the last wildcard appear only as fields.
+
+       Log.notice("motor at %d rpm" CR, logField("rpm", rpm), logField("load", load));
+
+   prints {"level":"notice","msg":"motor at 1200 rpm","rpm":1200,"load":37}
+   A field refers to its value, so it must be used in the log call itself.
+*/
+template <typename T>
+class LogField
+{
+  public:
+    LogField(const char *name, const T &value) : _name(name), _value(value), _flash(false) {}
+
+    LogField(const __FlashStringHelper *name, const T &value)
+      : _name(reinterpret_cast<const char *>(name)), _value(value), _flash(true) {}
+
+    const char *name() const { return _name; }
+
+    bool isFlash() const { return _flash; }
+
+    const T &value() const { return _value; }
+
+  private:
+    const char *_name;
+    const T &_value;
+    bool _flash;
+};
+
+/**
+   Makes a LogField, deducing the type of the value.
+
+   \param name - the field name, a string or F("name")
+   \param value - the value
+   \return the field
+*/
+template <typename N, typename T>
+LogField<T> logField(N name, const T &value)
+{
+  return LogField<T>(name, value);
+}
+
+#ifdef LOG_ENABLE_STATS
+/**
+   Counters returned by Logging::getStats(). Arrays are indexed by level - 1.
+   Messages that the LOG_xxx macros or LOG_LEVEL_MAX remove before they
+   reach the logger are not counted as filtered.
+*/
+struct LogStats
+{
+  uint32_t emitted[LOG_LEVEL_VERBOSE];    // records formatted and written
+  uint32_t filtered[LOG_LEVEL_VERBOSE];   // records rejected by the level check
+  uint32_t bytesWritten;                  // bytes handed to the outputs, summed over outputs
+  uint32_t dropped;                       // records lost in the async buffer
+  uint32_t suppressed;                    // records suppressed by the rate limit
+  uint32_t sampled;                       // records skipped by sampling
+  uint32_t formatMicros;                  // time spent building records
+  uint32_t outputMicros;                  // time spent in the outputs' write()
+};
+#endif
+
+#ifdef LOG_SAMPLING
+/**
+   LogSampler decides per level whether a record is one of the sample.
+   A level keeps either every n-th record, starting with the first, or
+   each record with a chance of 1 in n, drawn from an xorshift generator.
+   Levels with a rate of 0 or 1 keep all records and cost one compare.
+*/
+class LogSampler
+{
+  public:
+    LogSampler();
+
+    /**
+       Sets the sample rate of a level.
+
+       \param level - the level, LOG_LEVEL_FATAL to LOG_LEVEL_VERBOSE
+       \param rate - keep 1 in rate records, 0 or 1 to keep all
+       \param random - true to draw each record at random
+       \return void
+    */
+    void setRate(uint8_t level, uint16_t rate, bool random);
+
+    /**
+       \param level - the level of a record, LOG_LEVEL_FATAL to
+                       LOG_LEVEL_VERBOSE
+       \return true if the record is kept
+    */
+    bool sample(uint8_t level)
+    {
+      Rate &entry = _rates[level - 1];
+      return entry.rate <= 1 || take(entry);
+    }
+
+  private:
+    struct Rate
+    {
+      uint16_t rate;
+      uint16_t count;     // records since the last kept one
+      bool random;
+    };
+
+    bool take(Rate &entry);
+
+    Rate _rates[LOG_LEVEL_VERBOSE];
+    uint32_t _state;
+};
+#endif
+
+#define LOG_NO_TAG     0xFF
+#define LOG_TAG_LENGTH 3
+#define LOG_DEFAULT_PRECISION 2
+#define LOG_MAX_PRECISION     9
+
+#ifdef LOG_RETAINED_SIZE
+/**
+   LogRetained is the output behind the flight recorder. It copies the
+   output into a ring buffer in RAM that is not cleared at startup, so
+   after a reset that did not remove power the last records can still be
+   printed. A write costs a memcpy() and a CRC over the small header. The
+   header is updated after the data, so a reset in the middle of a write
+   loses at most that write.
+*/
+class LogRetained : public Print
+{
+  public:
+    /**
+       Keeps the buffer if its header is valid, or empties it otherwise.
+
+       \return void
+    */
+    void begin();
+
+    /**
+       Prints the buffer, oldest output first, if its header is valid, and
+       empties it.
+
+       \param output - where to print it
+       \return the number of bytes printed
+    */
+    size_t dump(Print &output);
+
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *data, size_t size);
+    using Print::write;
+
+  private:
+    static bool isValid();
+
+    static void commit(uint16_t head, uint16_t length);
+
+    static uint16_t checksum(uint16_t head, uint16_t length);
+};
+#endif
+
+/**
+   LogSink is an output that is told where records start and end, e.g. to
+   send one or several records as a network packet. Add it with begin(),
+   setOutput() or addOutput() like any Print. beginRecord() comes before
+   the first byte of every record written to the sink, endRecord() after
+   the last one; with LOG_ASYNC_BUFFER_SIZE both are called from drain().
+*/
+class LogSink : public Print
+{
+  public:
+    /**
+       Called when a record starts.
+
+       \param level - the level of the record
+       \return void
+    */
+    virtual void beginRecord(int level) = 0;
+
+    /**
+       Called when a record is complete.
+
+       \param level - the level of the record
+       \return void
+    */
+    virtual void endRecord(int level) = 0;
+};
+
+/**
+   LogOutputs is the table of outputs a Logging instance writes to. Each
+   entry has its own level threshold and showLevel flag. A record is only
+   formatted once: write() hands every chunk of it to the outputs selected
+   by the record's mask, and leaves out the level tag for the outputs that
+   do not show it.
+*/
+class LogOutputs : public Print
+{
+  public:
+    LogOutputs() : _count(0), _mask(0), _sinks(0), _tagOffset(LOG_NO_TAG), _level(LOG_LEVEL_SILENT), _offset(0) {}
+
+    /**
+       Sets the primary output (entry 0), which logs all levels.
+
+       \param output - pointer to the Print object
+       \param sink - true if output is a LogSink
+       \return void
+    */
+    void setPrimary(Print *output, bool sink = false);
+
+    /**
+       Adds an output after the primary one.
+
+       \param output - pointer to the Print object
+       \param level - highest level sent to this output
+       \param showLevel - whether this output shows the level tag
+       \param sink - true if output is a LogSink
+       \return false if the table is full
+    */
+    bool add(Print *output, int level, bool showLevel, bool sink = false);
+
+    /**
+       Removes an output. Removing the primary output leaves entry 0
+       empty, the other outputs keep their entries.
+
+       \param output - pointer to the Print object
+       \return false if the output was not found
+    */
+    bool remove(Print *output);
+
+    /**
+       Changes the level threshold of an output.
+
+       \param output - pointer to the Print object
+       \param level - highest level sent to this output
+       \return false if the output was not found
+    */
+    bool setLevel(Print *output, int level);
+
+    /**
+       Highest level any output accepts.
+
+       \return the highest level, LOG_LEVEL_SILENT without outputs
+    */
+    int getMaxLevel() const;
+
+    /**
+       Bit mask of the outputs that accept a level.
+
+       \param level - the level of the record
+       \return bit i is set if output i accepts the level
+    */
+    uint8_t getMask(int level) const;
+
+    /**
+       Starts a record that goes to the outputs in mask.
+
+       \param mask - outputs to write to, from getMask()
+       \param tagOffset - position of the level tag, or LOG_NO_TAG
+       \param level - the level of the record
+       \return void
+    */
+    void beginRecord(uint8_t mask, uint8_t tagOffset, uint8_t level)
+    {
+      _mask = mask;
+      _tagOffset = tagOffset;
+      _level = level;
+      _offset = 0;
+      if (_sinks & mask)
+      {
+        notifySinks(true);
+      }
+    }
+
+    /**
+       Ends the record started with beginRecord().
+
+       \return void
+    */
+    void endRecord()
+    {
+      if (_sinks & _mask)
+      {
+        notifySinks(false);
+      }
+    }
+
+    /**
+       Sets the position of the level tag in the current record.
+
+       \param tagOffset - position of the level tag, or LOG_NO_TAG
+       \return void
+    */
+    void setTagOffset(uint8_t tagOffset) { _tagOffset = tagOffset; }
+
+#ifdef LOG_ENABLE_STATS
+    uint32_t getBytesWritten() const { return _bytesWritten; }
+
+    uint32_t getOutputMicros() const { return _outputMicros; }
+
+    void resetStats()
+    {
+      _bytesWritten = 0;
+      _outputMicros = 0;
+    }
+#endif
+
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *buffer, size_t size);
+
+  private:
+    struct Entry
+    {
+      Print* output;
+      int8_t level;
+      bool showLevel;
+      bool sink;
+    };
+
+    void notifySinks(bool begin);
+
+    void updateSinks();
+
+    Entry _entries[LOG_MAX_OUTPUTS];
+    uint8_t _count;
+    uint8_t _mask;
+    uint8_t _sinks;       // bit i is set if output i is a LogSink
+    uint8_t _tagOffset;
+    uint8_t _level;
+    uint16_t _offset;
+#ifdef LOG_ENABLE_STATS
+    uint32_t _bytesWritten = 0;
+    uint32_t _outputMicros = 0;
+#endif
+};
+
+#ifdef LOG_ASYNC_BUFFER_SIZE
+/**
+   LogRingBuffer is a single-producer/single-consumer queue of complete log
+   records. The producer (printLevel) writes a record with beginRecord(),
+   write() and commitRecord(); the record only becomes visible to the
+   consumer (drain) once it is committed, so the output never contains
+   half a record. Each record is stored behind a five byte header (length,
+   output mask, level tag position and level), which lets the producer discard
+   whole records when the buffer is full.
+
+   The queue is lock-free as long as there is one producer and one
+   consumer. LOG_OVERFLOW_DROP_OLDEST and LOG_OVERFLOW_BLOCK without a
+   drain task touch the consumer side too, so with those policies drain()
+   must be called from the same context that logs.
+   With LOG_THREAD_SAFE several producers take turns under the logger's
+   lock, and one consumer drains without it.
 */
+class LogRingBuffer : public Print
+{
+  public:
+    LogRingBuffer();
+
+    /**
+       Sets the outputs drained records are written to.
+
+       \param output - pointer to the output table
+       \return void
+    */
+    void setOutput(LogOutputs *output) { _output = output; }
+
+    /**
+       Sets what happens when a record does not fit in the buffer.
+
+       \param policy - LOG_OVERFLOW_DROP_NEWEST, LOG_OVERFLOW_DROP_OLDEST
+                        or LOG_OVERFLOW_BLOCK
+       \return void
+    */
+    void setOverflowPolicy(uint8_t policy) { _policy = policy; }
+
+    /**
+       Tells the buffer whether a separate task is draining it. With a drain
+       task LOG_OVERFLOW_BLOCK waits for space instead of draining in place.
+
+       \param active - true if another task calls drain()
+       \return void
+    */
+    void setConsumerActive(bool active) { _consumerActive = active; }
+
+    /**
+       Number of records dropped because the buffer was full.
+
+       \return the number of dropped records
+    */
+    uint32_t getDroppedCount() const { return _dropped; }
+
+    /**
+       Resets the dropped record counter.
+
+       \return void
+    */
+    void resetDroppedCount() { _dropped = 0; }
+
+    /**
+       Returns the policy set with setOverflowPolicy().
+    */
+    uint8_t getOverflowPolicy() const { return _policy; }
+
+    /**
+       Counts a record that was dropped before it reached the buffer.
+
+       \return void
+    */
+    void addDropped() { _dropped++; }
+
+    /**
+       Returns true if there is nothing left to drain.
+    */
+    bool isEmpty() const { return _head == _tail && _drainRemaining == 0; }
+
+    /**
+       Starts a new record. The overflow policy can be overridden for the
+       record, e.g. to never wait when logging from an interrupt.
+
+       \param policy - the overflow policy for this record
+       \return void
+    */
+    void beginRecord(uint8_t policy);
+    void beginRecord() { beginRecord(_policy); }
+
+    /**
+       Makes the record visible to drain().
+
+       \return false if the record did not fit and was dropped
+    */
+    bool commitRecord(uint8_t mask, uint8_t tagOffset, uint8_t level);
+
+    /**
+       Writes queued records to the output.
+
+       \param maxBytes - upper bound on the number of bytes written
+       \return the number of bytes written
+    */
+    size_t drain(size_t maxBytes);
+
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *buffer, size_t size);
+
+  private:
+    static const uint16_t MASK = LOG_ASYNC_BUFFER_SIZE - 1;
+    static const uint8_t HEADER = 5;    // length (2), mask, tag offset, level
+
+    uint16_t freeSpace() const { return MASK - ((_pending - _tail) & MASK); }
+    bool reserve(size_t n);
+    bool dropOldest();
+
+    uint8_t _data[LOG_ASYNC_BUFFER_SIZE];
+    volatile uint16_t _head;
+    volatile uint16_t _tail;
+    volatile uint16_t _drainRemaining;
+    uint16_t _pending;
+    uint16_t _recordStart;
+    bool _recordFailed;
+    volatile bool _consumerActive;
+    uint8_t _policy;
+    uint8_t _recordPolicy;
+    volatile uint32_t _dropped;
+    LogOutputs* _output;
+};
+#endif
+
+#ifdef LOG_THREAD_SAFE
+#if defined(ARDUINO_ARCH_RP2040)
+#include <pico/mutex.h>
+#include <pico/critical_section.h>
+#endif
+
+/**
+   LogLock serializes the publishing of finished records. With
+   LOG_ASYNC_BUFFER_SIZE it is a short critical section around the copy
+   into the ring buffer, which can also be entered from an interrupt;
+   otherwise it is a mutex held while the record is written to the
+   outputs. On platforms without threads only the asynchronous variant
+   does anything (it disables interrupts).
+*/
+class LogLock
+{
+  public:
+    LogLock();
+
+    /**
+       Creates the RTOS objects, called by Logging::begin().
+
+       \return void
+    */
+    void begin();
+
+    void lock();
+    void unlock();
+
+#ifdef LOG_ASYNC_BUFFER_SIZE
+    /**
+       Enters the critical section from an interrupt handler without
+       waiting for another core that holds it.
+
+       \return true if the lock was taken
+    */
+    bool tryLockFromISR();
+    void unlockFromISR();
+#endif
+
+  private:
+#ifdef LOG_ASYNC_BUFFER_SIZE
+#if defined(ESP32)
+    portMUX_TYPE _mux;
+#elif defined(ARDUINO_ARCH_RP2040)
+    critical_section_t _section;
+#elif defined(INC_FREERTOS_H)
+    UBaseType_t _isrState;
+#elif defined(__AVR__)
+    uint8_t _sreg;
+#endif
+#else
+#if defined(ARDUINO_ARCH_RP2040)
+    mutex_t _mutex;
+#elif defined(ESP32) || defined(INC_FREERTOS_H)
+    SemaphoreHandle_t _mutex;
+#endif
+#endif
+};
+
+struct LogRecord;
+
+/**
+   LogPublisher is the output of a record buffer on the caller's stack.
+   Its first write takes the logger's lock and starts the record on the
+   outputs, so a record reaches them in one piece however many tasks log
+   at the same time. Records that fit in the buffer are written with a
+   single short lock; longer ones keep the lock until they are complete.
+*/
+class LogPublisher : public Print
+{
+  public:
+    typedef size_t (*publishfunction)(void *logger, LogRecord &record, const uint8_t *buffer, size_t size);
+
+    template <class Logger>
+    LogPublisher(Logger *logger, LogRecord *record)
+      : _logger(logger), _publish(publishTo<Logger>), _record(record) {}
+
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *buffer, size_t size);
+
+  private:
+    template <class Logger>
+    static size_t publishTo(void *logger, LogRecord &record, const uint8_t *buffer, size_t size)
+    {
+      return static_cast<Logger *>(logger)->publish(record, buffer, size);
+    }
+
+    void *_logger;
+    publishfunction _publish;
+    LogRecord *_record;
+};
+#endif
+
+#if defined(LOG_SCOPE_SIZE) && !defined(DISABLE_LOGGING)
+/**
+   LogContext holds the text of the open LogScopes, separated by spaces,
+   as a stack: push() starts a scope at the end of the text, which is then
+   written to it like to any Print, and pop() cuts it off again. Scopes
+   nested deeper than LOG_SCOPE_DEPTH, and text beyond LOG_SCOPE_SIZE, are
+   left out.
+*/
+class LogContext : public Print
+{
+  public:
+    LogContext() : _length(0), _depth(0) {}
+
+    void push();
+
+    void pop();
+
+    const char *text() const { return _text; }
+
+    uint8_t length() const { return _length; }
+
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *data, size_t size);
+    using Print::write;
+
+  private:
+    char _text[LOG_SCOPE_SIZE];
+    uint8_t _length;
+    uint8_t _depth;                     // open scopes, including left out ones
+    uint8_t _starts[LOG_SCOPE_DEPTH];   // length of the text before each scope
+};
+#endif
+
+/**
+   LogRecord is the state of the record being formatted: the line buffer
+   and what is known about the record so far. The logger owns a single
+   instance; with LOG_THREAD_SAFE every call creates its own on its stack.
+*/
+struct LogRecord
+{
+#ifdef LOG_THREAD_SAFE
+  template <class Logger>
+  LogRecord(Logger *logger, bool isr)
+    : publisher(logger, this),
+      fieldWidth(0),
+      fieldPrecision(LOG_DEFAULT_PRECISION),
+      fieldPad(' '),
+      published(false),
+      failed(false),
+      fromISR(isr)
+  {
+    buffer.setOutput(&publisher);
+  }
+
+  LogPublisher publisher;
+#else
+  LogRecord() : fieldWidth(0), fieldPrecision(LOG_DEFAULT_PRECISION), fieldPad(' ') {}
+#endif
+
+  LogBuffer buffer;
+  uint8_t mask;            // outputs the record is written to
+  uint8_t level;
+  uint8_t tagOffset;       // position of the level tag, LOG_NO_TAG if none
+  uint8_t fieldWidth;      // width, precision and padding of the current wildcard
+  uint8_t fieldPrecision;
+  char fieldPad;
+#ifdef LOG_BINARY_FORMAT
+  uint8_t checksum;
+  uint8_t intSize;         // bytes of each %d %i %x %X %b %B argument
+#endif
+#ifdef LOG_ENABLE_STATS
+  unsigned long startMicros;
+  uint32_t startOutputMicros;
+#endif
+#ifdef LOG_THREAD_SAFE
+  bool published;          // the lock is held and the outputs know the record
+  bool failed;             // the record is dropped
+  bool fromISR;
+#endif
+};
+
+/**
+   LogConfig is the configuration of the Logging class. BasicLogging
+   takes a configuration of your own, which can leave out features: a
+   disabled feature has no data members and its branches fold away at
+   compile time. Derive from LogConfig to change only some of them:
+
+       struct TinyLogConfig : LogConfig
+       {
+         static const int maxLevel = LOG_LEVEL_WARNING;
+         static const bool prefix = false;
+         static const bool timestamp = false;
+       };
+       BasicLogging<TinyLogConfig> tinyLog;
+
+   maxLevel      highest level compiled in; log calls above it generate
+                 no code. It cannot raise LOG_LEVEL_MAX.
+   prefix        setPrefix() and setSuffix()
+   showLevel     the level letter in front of text records; without it
+                 setShowLevel() is ignored
+   timestamp     setTimestamp()
+
+   The buffer size and the outputs stay set by LOG_BUFFER_SIZE and
+   LOG_MAX_OUTPUTS, which are shared with LogScope and the sinks.
+*/
+struct LogConfig
+{
+  static const int maxLevel = LOG_LEVEL_MAX;
+  static const bool prefix = true;
+  static const bool showLevel = true;
+  static const bool timestamp = true;
+};
+
+#ifndef DISABLE_LOGGING
+#define LOG_FEATURE(enabled) (enabled)
+#else
+#define LOG_FEATURE(enabled) false
+#endif
+
+/**
+   The optional features of BasicLogging are kept in these bases. The
+   specialization for a disabled feature is empty, so it takes no RAM,
+   and its accessors return constants.
+*/
+template <bool Enabled>
+class LogCallbackPolicy
+{
+  protected:
+    LogCallbackPolicy() : _prefix(NULL), _suffix(NULL) {}
+
+    printfunction prefixFunction() const { return _prefix; }
+
+    printfunction suffixFunction() const { return _suffix; }
+
+    void setPrefixFunction(printfunction f) { _prefix = f; }
+
+    void setSuffixFunction(printfunction f) { _suffix = f; }
+
+  private:
+    printfunction _prefix;
+    printfunction _suffix;
+};
+
+template <>
+class LogCallbackPolicy<false>
+{
+  protected:
+    printfunction prefixFunction() const { return NULL; }
+
+    printfunction suffixFunction() const { return NULL; }
+
+    void setPrefixFunction(printfunction) {}
+
+    void setSuffixFunction(printfunction) {}
+};
+
+template <bool Enabled>
+class LogShowLevelPolicy
+{
+  protected:
+    LogShowLevelPolicy() : _showLevel(true) {}
+
+    bool showsLevel() const { return _showLevel; }
+
+    void setShowsLevel(bool showLevel) { _showLevel = showLevel; }
+
+  private:
+    bool _showLevel;
+};
+
+template <>
+class LogShowLevelPolicy<false>
+{
+  protected:
+    bool showsLevel() const { return false; }
+
+    void setShowsLevel(bool) {}
+};
+
+/**
+   LogNoTimestamp stands in for LogTimestamp when timestamps are left out.
+*/
+class LogNoTimestamp
+{
+  public:
+    void setMode(uint8_t, timefunction) {}
+
+    uint8_t getMode() const { return LOG_TIMESTAMP_NONE; }
+
+    void print(LogBuffer &, bool = true) {}
+
+    void printMillis(LogBuffer &, bool = true) {}
+
+    bool isCached() const { return false; }
+};
+
+template <bool Enabled>
+class LogTimestampPolicy
+{
+  protected:
+    LogTimestamp &timestamp() { return _timestamp; }
+
+  private:
+    LogTimestamp _timestamp;
+};
+
+template <>
+class LogTimestampPolicy<false>
+{
+  protected:
+    LogNoTimestamp timestamp() const { return LogNoTimestamp(); }
+};
+
+template <class Config>
+class BasicLogging
+  : private LogCallbackPolicy<LOG_FEATURE(Config::prefix)>,
+    private LogShowLevelPolicy<LOG_FEATURE(Config::showLevel)>,
+    private LogTimestampPolicy<LOG_FEATURE(Config::timestamp)>
+{
+  public:
+    /**
+       default Constructor
+    */
+    BasicLogging()
+#ifndef DISABLE_LOGGING
+      : _level(LOG_LEVEL_SILENT),
+        _activeLevel(LOG_LEVEL_SILENT),
+        _recordFormat(LOG_RECORD_TEXT)
+#endif
+    {
+#if !defined(DISABLE_LOGGING) && defined(LOG_ENABLE_STATS)
+      memset(&_stats, 0, sizeof(_stats));
+#endif
+#if !defined(DISABLE_LOGGING) && defined(LOG_MAX_TAGS)
+      for (uint8_t i = 0; i < LOG_MAX_TAGS; i++)
+      {
+        _tagLevel[i] = LOG_LEVEL_INHERIT;
+        _tagActiveLevel[i] = LOG_LEVEL_SILENT;
+      }
+#endif
+#if !defined(DISABLE_LOGGING) && defined(LOG_MAX_SPECIFIERS)
+      _specifierCount = 0;
+#endif
+
+    }
+
+    /**
+       Initializing, must be called as first. Note that if you use
+       this variant of Init, you need to initialize the baud rate
+       yourself, if printer happens to be a serial port.
+
+       \param level - logging levels <= this will be logged.
+       \param printer - place that logging output will be sent to.
+       \return void
+
+    */
+    LOG_COLD void begin(int level, Print *output, bool showLevel = true);
+
+    /**
+       Initializing with a LogSink as output, which is told where each
+       record starts and ends.
+
+       \param level - logging levels <= this will be logged.
+       \param output - the sink that logging output will be sent to.
+       \param showLevel - whether to show the log level
+       \return void
+    */
+    LOG_COLD void begin(int level, LogSink *output, bool showLevel = true);
+
+    /**
+       Set the log level.
+
+       \param level - The new log level.
+       \return void
+    */
+    LOG_COLD void setLevel(int level);
+
+    /**
+       Get the log level.
+
+       \return The current log level.
+    */
+    int getLevel() const;
+
+    /**
+       Set whether to show the log level.
+
+       \param showLevel - true if the log level should be shown for each log
+                          false otherwise.
+       \return void
+    */
+    LOG_COLD void setShowLevel(bool showLevel);
+
+    /**
+       Get whether the log level is shown during logging
+
+       \return true if the log level is be shown for each log
+               false otherwise.
+    */
+    bool getShowLevel() const;
+
+    /**
+       Returns true if messages of the given level are currently logged.
+       Use it to skip computing log arguments that would be discarded.
+
+       \param level - the level to test
+       \return true if a message of this level would be output
+    */
+    bool isEnabled(int level) const
+    {
+#ifndef DISABLE_LOGGING
+      return level <= Config::maxLevel && level <= _activeLevel;
+#else
+      return false;
+#endif
+    }
+
+    /**
+       Returns true if messages of the given level are currently logged for
+       a tag.
+
+       \param tag - the tag to test
+       \param level - the level to test
+       \return true if a message of this level and tag would be output
+    */
+    bool isEnabled(const LogTag &tag, int level) const
+    {
+#if !defined(DISABLE_LOGGING) && defined(LOG_MAX_TAGS)
+      return level <= Config::maxLevel && level <= _tagActiveLevel[tag.id()];
+#else
+      (void)tag;
+      return isEnabled(level);
+#endif
+    }
+
+#ifdef LOG_MAX_TAGS
+    /**
+       Set the log level of one tag, independently of the global level.
+
+       \param tag - the tag to change
+       \param level - the new level, or LOG_LEVEL_INHERIT to follow setLevel()
+       \return void
+    */
+    LOG_COLD void setTagLevel(const LogTag &tag, int level);
+
+    /**
+       Get the log level of a tag.
+
+       \param tag - the tag
+       \return the level of the tag, the global level if it inherits it
+    */
+    int getTagLevel(const LogTag &tag) const;
+#endif
+
+#ifdef LOG_MAX_SPECIFIERS
+    /**
+       Adds a format specifier for a type of your own. The argument for it
+       is passed as a pointer, and the handler prints the value it points
+       to straight into the record:
+
+           void printMac(Print *output, const void *value) { ... }
+           Log.addSpecifier('M', printMac);
+           Log.notice("peer %M" CR, mac);    // uint8_t mac[6]
+
+       Adding a specifier again replaces its handler. Field width and
+       padding are not applied.
+
+       \param specifier - the character after the %, not a digit, '.' or '%'
+       \param handler - prints the value
+       \return false if the table is full or the specifier is invalid
+    */
+    LOG_COLD bool addSpecifier(char specifier, formatfunction handler);
+#endif
+
+    /**
+       Opens a scope; used by LogScope. The context is formatted like a
+       message, once, and printed in front of the message of every record
+       until popScope().
+
+       \param format - format string of the context
+       \param ... any number of variables
+       \return void
+    */
+    template <class T, typename... Args> void pushScope(T format, const Args&... args)
+    {
+#if !defined(DISABLE_LOGGING) && defined(LOG_SCOPE_SIZE) && !defined(LOG_BINARY_FORMAT)
+#ifdef LOG_THREAD_SAFE
+      LogRecord record(this, false);
+#else
+      LogRecord record;
+#endif
+      _context.push();
+      record.buffer.setOutput(&_context);
+      printArgs(record, formatString(format), isFlashString(format), args...);
+      record.buffer.flush();
+#else
+      (void)format;
+      (void)sizeof...(args);
+#endif
+    }
+
+    /**
+       Closes the innermost scope; used by LogScope.
+
+       \return void
+    */
+    void popScope()
+    {
+#if !defined(DISABLE_LOGGING) && defined(LOG_SCOPE_SIZE) && !defined(LOG_BINARY_FORMAT)
+      _context.pop();
+#endif
+    }
+
+    /**
+       Sets a function to be called before each log command.
+
+       \param f - The function to be called
+       \return void
+    */
+    LOG_COLD void setPrefix(printfunction f);
+
+    /**
+       Sets a function to be called after each log command.
+
+       \param f - The function to be called
+       \return void
+    */
+    LOG_COLD void setSuffix(printfunction f);
+
+    /**
+       Prints a built-in timestamp at the start of each record, before the
+       prefix function. The formats are:
+
+       LOG_TIMESTAMP_NONE    no timestamp (default)
+       LOG_TIMESTAMP_MILLIS  millis(), right aligned: "    123456 "
+       LOG_TIMESTAMP_MICROS  micros(), right aligned
+       LOG_TIMESTAMP_UPTIME  time since start: "01:02:03.456 "
+       LOG_TIMESTAMP_RTC     wall clock from a function returning the Unix
+                             time, e.g. of an RTC: "2024-05-01 13:45:12 "
+
+       Binary records carry their own timestamp and ignore this setting.
+
+       \param mode - one of the modes above
+       \param clock - for LOG_TIMESTAMP_RTC, function returning the Unix time
+       \return void
+    */
+    LOG_COLD void setTimestamp(uint8_t mode, timefunction clock = NULL);
+
+    /**
+       Selects how records are rendered:
+
+       LOG_RECORD_TEXT    "N: wifi: connected" (default)
+       LOG_RECORD_JSON    one JSON object per line:
+                          {"ts":1234,"level":"notice","tag":"wifi","msg":"connected"}
+       LOG_RECORD_LOGFMT  ts=1234 level=notice tag="wifi" msg="connected"
+
+       The structured formats are rendered in the same single pass into the
+       line buffer as text. The message is escaped, a trailing CR is
+       dropped and every record ends with a newline. The timestamp is only
+       present with setTimestamp(), and LogField arguments are added as
+       fields after the message. The level is always included, while the
+       prefix and suffix functions are not called. Binary records ignore
+       this setting.
+
+       \param format - one of the formats above
+       \return void
+    */
+    LOG_COLD void setRecordFormat(uint8_t format);
+
+#ifdef LOG_RATE_LIMIT
+    /**
+       Sets the rate limit applied to each call site (format string): it
+       may log burst messages at once, and one more per interval. Further
+       messages return before they are formatted. When the call site may
+       log again, a summary of how many were suppressed comes first:
+
+           E: suppressed 1234 messages: I2C timeout %d
+
+       The default is a burst of 10 and an interval of 1000 ms.
+
+       \param burst - messages logged at once, 0 to disable the limit
+       \param interval - milliseconds per additional message
+       \return void
+    */
+    LOG_COLD void setRateLimit(uint8_t burst, uint16_t interval);
+#endif
+
+#ifdef LOG_SAMPLING
+    /**
+       Logs only a sample of the records of a level. The decision is made
+       right after the level check, before anything is formatted, so a
+       record that is left out costs about as much as a filtered one. A
+       level either keeps every rate-th record, starting with the next
+       one, or every record with a chance of 1 in rate. Both kinds of
+       sample apply to all outputs; LOG_EVERY_N() samples one call site.
+
+           Log.setSampleRate(LOG_LEVEL_TRACE, 100);         // every 100th
+           Log.setSampleRate(LOG_LEVEL_VERBOSE, 50, true);  // 1 in 50 at random
+
+       \param level - the level, LOG_LEVEL_FATAL to LOG_LEVEL_VERBOSE
+       \param rate - keep 1 in rate records, 0 or 1 to keep all
+       \param random - true to draw each record at random
+       \return void
+    */
+    LOG_COLD void setSampleRate(int level, uint16_t rate, bool random = false);
+#endif
+
+    /**
+       Sets an output handler for the Log entires.
+
+       \param output - pointer to the Print object
+       \return void
+    */
+    LOG_COLD void setOutput( Print *output );
+
+    /**
+       Sets a LogSink as output for the Log entries.
+
+       \param output - pointer to the sink
+       \return void
+    */
+    LOG_COLD void setOutput(LogSink *output);
+
+    /**
+       Adds an additional output for the Log entries. Each record is
+       formatted once and written to every output whose level admits it.
+
+       \param output - pointer to the Print object
+       \param level - highest level written to this output
+       \param showLevel - whether to show the log level on this output
+       \return false if LOG_MAX_OUTPUTS outputs are already in use
+    */
+    LOG_COLD bool addOutput(Print *output, int level = LOG_LEVEL_VERBOSE, bool showLevel = true);
+
+    /**
+       Adds a LogSink as additional output.
+
+       \param output - pointer to the sink
+       \param level - highest level written to this output
+       \param showLevel - whether to show the log level on this output
+       \return false if LOG_MAX_OUTPUTS outputs are already in use
+    */
+    LOG_COLD bool addOutput(LogSink *output, int level = LOG_LEVEL_VERBOSE, bool showLevel = true);
+
+    /**
+       Removes an output added with setOutput() or addOutput().
+
+       \param output - pointer to the Print object
+       \return false if the output was not found
+    */
+    LOG_COLD bool removeOutput(Print *output);
+
+    /**
+       Changes the level of an output.
+
+       \param output - pointer to the Print object
+       \param level - highest level written to this output
+       \return false if the output was not found
+    */
+    LOG_COLD bool setOutputLevel(Print *output, int level);
+
+#ifdef LOG_RETAINED_SIZE
+    /**
+       Flight recorder: keeps the records up to a level in a RAM buffer of
+       LOG_RETAINED_SIZE bytes that survives a reset, in addition to the
+       normal outputs. The buffer is an output of its own, so the other
+       outputs can stay at a lower level:
+
+           Log.begin(LOG_LEVEL_VERBOSE, &Serial);
+           Log.setOutputLevel(&Serial, LOG_LEVEL_WARNING);
+           Log.setFlightRecorder(LOG_LEVEL_VERBOSE);
+
+       \param level - highest level retained, LOG_LEVEL_SILENT to stop
+       \return false if LOG_MAX_OUTPUTS outputs are already in use
+    */
+    LOG_COLD bool setFlightRecorder(int level);
+
+    /**
+       Prints the output retained before the last reset, oldest first, and
+       empties the buffer. Call it at startup, before setFlightRecorder().
+       After power on the buffer holds random data, which is detected by
+       its header and not printed.
+
+       \param output - where to print it
+       \return the number of bytes printed
+    */
+    LOG_COLD size_t dumpRetained(Print &output);
+#endif
+
+#ifdef LOG_ENABLE_STATS
+    /**
+       Get the statistics collected since startup or the last resetStats().
+
+       \return a copy of the counters
+    */
+    LogStats getStats() const;
+
+    /**
+       Reset all statistics counters to zero.
+
+       \return void
+    */
+    void resetStats();
+#endif
+
+#ifdef LOG_ASYNC_BUFFER_SIZE
+    /**
+       Writes queued log records to the output. Call this regularly from
+       loop(), or use startDrainTask() on ESP32.
+
+       \param maxBytes - upper bound on the number of bytes written
+       \return the number of bytes written
+    */
+    size_t drain(size_t maxBytes = (size_t)-1);
+
+    /**
+       Sets what happens when a record does not fit in the async buffer.
+
+       \param policy - LOG_OVERFLOW_DROP_NEWEST (default), LOG_OVERFLOW_DROP_OLDEST
+                        or LOG_OVERFLOW_BLOCK
+       \return void
+    */
+    LOG_COLD void setOverflowPolicy(uint8_t policy);
+
+    /**
+       Number of records dropped because the async buffer was full.
+
+       \return the number of dropped records
+    */
+    uint32_t getDroppedCount() const;
+
+#if defined(ESP32)
+    /**
+       Starts a FreeRTOS task that drains the async buffer in the background.
+
+       \param priority - task priority
+       \param stackSize - task stack size in bytes
+       \return true if the task was created
+    */
+    LOG_COLD bool startDrainTask(UBaseType_t priority = 1, uint32_t stackSize = 2048);
+#endif
+#endif
+
+    /**
+       Output a fatal error message. Output message contains
+       F: followed by original message
+       Fatal error messages are printed out at
+       loglevels >= LOG_LEVEL_FATAL
+
+       \param msg format string to output
+       \param ... any number of variables, passed by reference
+       \return void
+    */
+    template <class T, typename... Args> LOG_INLINE void fatal(T msg, const Args&... args)
+    {
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_FATAL
+      printLevel(LOG_LEVEL_FATAL, msg, args...);
+#endif
+    }
+
+    /**
+       Output an error message. Output message contains
+       E: followed by original message
+       Error messages are printed out at
+       loglevels >= LOG_LEVEL_ERROR
+
+       \param msg format string to output
+       \param ... any number of variables, passed by reference
+       \return void
+    */
+    template <class T, typename... Args> LOG_INLINE void error(T msg, const Args&... args) {
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_ERROR
+      printLevel(LOG_LEVEL_ERROR, msg, args...);
+#endif
+    }
+
+    /**
+       Output a warning message. Output message contains
+       W: followed by original message
+       Warning messages are printed out at
+       loglevels >= LOG_LEVEL_WARNING
+
+       \param msg format string to output
+       \param ... any number of variables, passed by reference
+       \return void
+    */
+    template <class T, typename... Args> LOG_INLINE void warning(T msg, const Args&... args)
+    {
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_WARNING
+      printLevel(LOG_LEVEL_WARNING, msg, args...);
+#endif
+    }
+
+    /**
+       Output a notice message. Output message contains
+       N: followed by original message
+       Notice messages are printed out at
+       loglevels >= LOG_LEVEL_NOTICE
+
+       \param msg format string to output
+       \param ... any number of variables, passed by reference
+       \return void
+    */
+    template <class T, typename... Args> LOG_INLINE void notice(T msg, const Args&... args)
+    {
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_NOTICE
+      printLevel(LOG_LEVEL_NOTICE, msg, args...);
+#endif
+    }
+
+    /**
+       Output a trace message. Output message contains
+       N: followed by original message
+       Trace messages are printed out at
+       loglevels >= LOG_LEVEL_TRACE
+
+       \param msg format string to output
+       \param ... any number of variables, passed by reference
+       \return void
+    */
+    template <class T, typename... Args> LOG_INLINE void trace(T msg, const Args&... args)
+    {
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_TRACE
+      printLevel(LOG_LEVEL_TRACE, msg, args...);
+#endif
+    }
+
+    /**
+       Output a verbose message. Output message contains
+       V: followed by original message
+       Debug messages are printed out at
+       loglevels >= LOG_LEVEL_VERBOSE
+
+       \param msg format string to output
+       \param ... any number of variables, passed by reference
+       \return void
+    */
+    template <class T, typename... Args> LOG_INLINE void verbose(T msg, const Args&... args)
+    {
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_VERBOSE
+      printLevel(LOG_LEVEL_VERBOSE, msg, args...);
+#endif
+    }
+
+    /**
+       Output a fatal error message for a tag. The message is filtered by the level of
+       the tag rather than the global level.
+
+       \param tag the tag (module) of the message
+       \param msg format string to output
+       \param ... any number of variables, passed by reference
+       \return void
+    */
+    template <class T, typename... Args> LOG_INLINE void fatal(const LogTag &tag, T msg, const Args&... args)
+    {
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_FATAL
+      printLevel(tag, LOG_LEVEL_FATAL, msg, args...);
+#endif
+    }
+
+    /**
+       Output an error message for a tag. The message is filtered by the level of
+       the tag rather than the global level.
+
+       \param tag the tag (module) of the message
+       \param msg format string to output
+       \param ... any number of variables, passed by reference
+       \return void
+    */
+    template <class T, typename... Args> LOG_INLINE void error(const LogTag &tag, T msg, const Args&... args)
+    {
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_ERROR
+      printLevel(tag, LOG_LEVEL_ERROR, msg, args...);
+#endif
+    }
+
+    /**
+       Output a warning message for a tag. The message is filtered by the level of
+       the tag rather than the global level.
+
+       \param tag the tag (module) of the message
+       \param msg format string to output
+       \param ... any number of variables, passed by reference
+       \return void
+    */
+    template <class T, typename... Args> LOG_INLINE void warning(const LogTag &tag, T msg, const Args&... args)
+    {
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_WARNING
+      printLevel(tag, LOG_LEVEL_WARNING, msg, args...);
+#endif
+    }
+
+    /**
+       Output a notice message for a tag. The message is filtered by the level of
+       the tag rather than the global level.
+
+       \param tag the tag (module) of the message
+       \param msg format string to output
+       \param ... any number of variables, passed by reference
+       \return void
+    */
+    template <class T, typename... Args> LOG_INLINE void notice(const LogTag &tag, T msg, const Args&... args)
+    {
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_NOTICE
+      printLevel(tag, LOG_LEVEL_NOTICE, msg, args...);
+#endif
+    }
+
+    /**
+       Output a trace message for a tag. The message is filtered by the level of
+       the tag rather than the global level.
+
+       \param tag the tag (module) of the message
+       \param msg format string to output
+       \param ... any number of variables, passed by reference
+       \return void
+    */
+    template <class T, typename... Args> LOG_INLINE void trace(const LogTag &tag, T msg, const Args&... args)
+    {
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_TRACE
+      printLevel(tag, LOG_LEVEL_TRACE, msg, args...);
+#endif
+    }
+
+    /**
+       Output a verbose message for a tag. The message is filtered by the level of
+       the tag rather than the global level.
+
+       \param tag the tag (module) of the message
+       \param msg format string to output
+       \param ... any number of variables, passed by reference
+       \return void
+    */
+    template <class T, typename... Args> LOG_INLINE void verbose(const LogTag &tag, T msg, const Args&... args)
+    {
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_VERBOSE
+      printLevel(tag, LOG_LEVEL_VERBOSE, msg, args...);
+#endif
+    }
+
+    /**
+       Output a block of memory as a hex dump. The level check, prefix and
+       a header line with the length are done once, then the data follows
+       in rows of LOG_HEXDUMP_WIDTH bytes, each with the offset, the bytes
+       in hex and their printable characters:
+
+           N: 20 bytes
+           0000  48 65 6C 6C 6F 20 77 6F 72 6C 64 00 01 02 03 04  Hello world.....
+           0010  05 06 07 08                                      ....
+
+       With LOG_ASYNC_BUFFER_SIZE every row is queued as a record of its
+       own, so dumps larger than the ring buffer stream through it.
+
+       \param level the level of the message, e.g. LOG_LEVEL_VERBOSE
+       \param data the memory to dump
+       \param length number of bytes
+       \return void
+    */
+    void hexdump(int level, const void *data, size_t length);
+
+    /**
+       Like hexdump(), for data stored in program memory (PROGMEM).
+
+       \param level the level of the message, e.g. LOG_LEVEL_VERBOSE
+       \param data the program memory to dump
+       \param length number of bytes
+       \return void
+    */
+    void hexdump_P(int level, const void *data, size_t length);
+
+#if defined(LOG_THREAD_SAFE) && defined(LOG_ASYNC_BUFFER_SIZE)
+    /**
+       Queues a message from an interrupt handler. The call never waits:
+       if the ring buffer is full, or another core is queueing a record
+       at the same moment, the message is dropped and counted in
+       getDroppedCount(). Prefix and suffix functions are called as for
+       other messages and must then be interrupt safe. The RTC function
+       of LOG_TIMESTAMP_RTC is not; such records show millis() instead.
+
+       \param level the level of the message, e.g. LOG_LEVEL_NOTICE
+       \param msg format string to output
+       \param ... any number of variables, passed by reference
+       \return true if the message was queued
+    */
+    template <class T, typename... Args> bool logFromISR(int level, T msg, const Args&... args)
+    {
+#ifndef DISABLE_LOGGING
+      if (level <= LOG_LEVEL_SILENT || level > Config::maxLevel || level > _activeLevel)
+      {
+        return false;
+      }
+#ifdef LOG_SAMPLING
+      if (!checkSample(level))
+      {
+        return false;
+      }
+#endif
+      LogRecord record(this, true);
+      formatRecord(record, level, NULL, msg, args...);
+      return !record.failed;
+#else
+      return false;
+#endif
+    }
+#endif
+
+  private:
+#ifdef LOG_THREAD_SAFE
+    friend class LogPublisher;
+
+    void publishRecord(LogRecord &record);
+
+    size_t publish(LogRecord &record, const uint8_t *buffer, size_t size);
+#endif
+
+    // Each argument is first mapped by logArgument() onto one of the few
+    // types printFormat() has an overload for, so that any integer, float,
+    // string or Printable type can be passed without a va_list.
+    static long logArgument(char value) { return value; }
+    static long logArgument(signed char value) { return value; }
+    static unsigned long logArgument(unsigned char value) { return value; }
+    static long logArgument(short value) { return value; }
+    static unsigned long logArgument(unsigned short value) { return value; }
+    static long logArgument(int value) { return value; }
+    static unsigned long logArgument(unsigned int value) { return value; }
+    static long logArgument(long value) { return value; }
+    static unsigned long logArgument(unsigned long value) { return value; }
+    static long long logArgument(long long value) { return value; }
+    static unsigned long long logArgument(unsigned long long value) { return value; }
+    static long logArgument(bool value) { return value; }
+    static double logArgument(float value) { return value; }
+    static double logArgument(double value) { return value; }
+    static const char *logArgument(const char *value) { return value; }
+    static const __FlashStringHelper *logArgument(const __FlashStringHelper *value) { return value; }
+    static const String &logArgument(const String &value) { return value; }
+    static const IPAddress &logArgument(const IPAddress &value) { return value; }
+    static const Printable &logArgument(const Printable &value) { return value; }
+    static const void *logArgument(const void *value) { return value; }
+    template <typename T>
+    static auto logArgument(const LogField<T> &field) -> decltype(logArgument(field.value())) { return logArgument(field.value()); }
+
+    static const char *formatString(const char *format) { return format; }
+    static const char *formatString(const __FlashStringHelper *format) { return reinterpret_cast<const char *>(format); }
+    static bool isFlashString(const char *) { return false; }
+    static bool isFlashString(const __FlashStringHelper *) { return true; }
+
+    /**
+       Prints the format string up to the next wildcard and returns the
+       wildcard character, or 0 at the end of the string. The field width
+       and padding of the wildcard are left in the record.
+    */
+    char printLiteral(LogRecord &record, const char *&format, bool flash, bool output);
+
+    void printFormat(LogRecord &record, const char format, long value);
+
+    void printFormat(LogRecord &record, const char format, unsigned long value);
+
+    void printFormat(LogRecord &record, const char format, long long value);
+
+    void printFormat(LogRecord &record, const char format, unsigned long long value);
+
+    void printFormat(LogRecord &record, const char format, double value);
+
+    void printFormat(LogRecord &record, const char format, const char *value);
+
+    void printFormat(LogRecord &record, const char format, const __FlashStringHelper *value);
+
+    void printFormat(LogRecord &record, const char format, const String &value);
+
+    void printFormat(LogRecord &record, const char format, const IPAddress &value);
+
+    void printFormat(LogRecord &record, const char format, const Printable &value);
+
+    void printFormat(LogRecord &record, const char format, const void *value);
+
+#ifdef LOG_MAX_SPECIFIERS
+    formatfunction findSpecifier(char specifier) const;
+#endif
+
+    /**
+       Prints the format string, replacing each specifier with the next
+       argument. The type of every argument is known here, so each one is
+       printed by the printFormat() overload for its type.
+    */
+    template <typename Arg, typename... Args>
+    void printArgs(LogRecord &record, const char *format, bool flash, const Arg &arg, const Args&... args)
+    {
+      char spec = printLiteral(record, format, flash, true);
+      if (spec == 0)
+      {
+        return;
+      }
+      printFormat(record, spec, logArgument(arg));
+      printArgs(record, format, flash, args...);
+    }
+
+    void printArgs(LogRecord &record, const char *format, bool flash)
+    {
+      while (printLiteral(record, format, flash, true) != 0) {}
+    }
+
+    void printPrefix(LogRecord &record, int level, const char *tagName);
+
+    void printStructuredPrefix(LogRecord &record, int level, const char *tagName);
+
+    void printTimestamp(LogRecord &record, bool padded);
+
+    void printKey(LogRecord &record, const char *name, bool flash, bool first);
+
+    void endMessage(LogRecord &record);
+
+    /**
+       Adds the LogField arguments as fields of a structured record. Other
+       arguments are skipped.
+    */
+    template <typename T, typename... Args>
+    void printFields(LogRecord &record, const LogField<T> &field, const Args&... args)
+    {
+      printKey(record, field.name(), field.isFlash(), false);
+      printFieldValue(record, field.value());
+      printFields(record, args...);
+    }
+
+    template <typename Arg, typename... Args>
+    void printFields(LogRecord &record, const Arg &, const Args&... args)
+    {
+      printFields(record, args...);
+    }
+
+    void printFields(LogRecord &) {}
+
+    template <typename T>
+    void printFieldValue(LogRecord &record, const T &value)
+    {
+      printFieldValue(record, logArgument(value));
+    }
+
+    void printFieldValue(LogRecord &record, bool value);
+
+    void printFieldValue(LogRecord &record, long value);
+
+    void printFieldValue(LogRecord &record, unsigned long value);
+
+    void printFieldValue(LogRecord &record, long long value);
+
+    void printFieldValue(LogRecord &record, unsigned long long value);
+
+    void printFieldValue(LogRecord &record, double value);
+
+    void printFieldValue(LogRecord &record, const char *value);
+
+    void printFieldValue(LogRecord &record, const __FlashStringHelper *value);
+
+    void printFieldValue(LogRecord &record, const String &value);
+
+    void printFieldValue(LogRecord &record, const IPAddress &value);
+
+    void printFieldValue(LogRecord &record, const Printable &value);
+
+    void printFieldValue(LogRecord &record, const void *value);
+
+    /**
+       Appends a value as a quoted string, escaped with the printFormat()
+       overload for its type.
+    */
+    template <typename T>
+    void printQuoted(LogRecord &record, const T &value)
+    {
+      record.buffer.append('"');
+      record.buffer.setEscape(true);
+      printFormat(record, 's', value);
+      record.buffer.setEscape(false);
+      record.buffer.append('"');
+    }
+
+#ifdef LOG_RATE_LIMIT
+    bool checkRate(int level, const char *format, bool flash);
+#endif
+
+#if defined(LOG_SAMPLING) && !defined(DISABLE_LOGGING)
+    LOG_INLINE bool checkSample(int level)
+    {
+      if (_sampler.sample(level))
+      {
+        return true;
+      }
+#ifdef LOG_ENABLE_STATS
+      _stats.sampled++;
+#endif
+      return false;
+    }
+#endif
+
+    void printHexdump(int level, const uint8_t *data, size_t length, bool flash);
+
+    void printHexdumpRow(LogRecord &record, const uint8_t *data, size_t offset, uint8_t count, bool flash);
+
+    void printSuffix(LogRecord &record);
+
+    void updateActiveLevel();
+
+    void beginRecord(LogRecord &record, int level);
+
+    void endRecord(LogRecord &record);
+
+#ifdef LOG_BINARY_FORMAT
+    template <typename Arg, typename... Args>
+    void printBinaryArgs(LogRecord &record, const char *format, bool flash, const Arg &arg, const Args&... args)
+    {
+      char spec = printLiteral(record, format, flash, false);
+      if (spec == 0)
+      {
+        return;
+      }
+      printBinaryArg(record, spec, logArgument(arg));
+      printBinaryArgs(record, format, flash, args...);
+    }
+
+    void printBinaryArgs(LogRecord &, const char *, bool) {}
+
+    // The integers of a binary record are all written as wide as the
+    // widest integer argument, at least an int, so that a long passed to
+    // %d or %x is not cut to the size of an int
+    template <typename T>
+    static constexpr uint8_t integerSize(const T &) { return 0; }
+    static constexpr uint8_t integerSize(int) { return sizeof(int); }
+    static constexpr uint8_t integerSize(unsigned int) { return sizeof(int); }
+    static constexpr uint8_t integerSize(long) { return sizeof(long); }
+    static constexpr uint8_t integerSize(unsigned long) { return sizeof(long); }
+    static constexpr uint8_t integerSize(long long) { return sizeof(long long); }
+    static constexpr uint8_t integerSize(unsigned long long) { return sizeof(long long); }
+    template <typename T>
+    static constexpr uint8_t integerSize(const LogField<T> &field) { return integerSize(field.value()); }
+
+    static constexpr uint8_t integerWidth() { return sizeof(int); }
+    template <typename Arg, typename... Args>
+    static constexpr uint8_t integerWidth(const Arg &arg, const Args&... args)
+    {
+      return integerSize(arg) > integerWidth(args...) ? integerSize(arg) : integerWidth(args...);
+    }
+
+    void printBinaryHeader(LogRecord &record, int level, const char *format, bool flash, uint8_t intSize = sizeof(int));
+
+    void printBinaryFooter(LogRecord &record);
+
+    void printBinaryArg(LogRecord &record, const char format, long value);
+
+    void printBinaryArg(LogRecord &record, const char format, unsigned long value);
+
+    void printBinaryArg(LogRecord &record, const char format, long long value);
+
+    void printBinaryArg(LogRecord &record, const char format, unsigned long long value);
+
+    void printBinaryArg(LogRecord &record, const char format, double value);
+
+    void printBinaryArg(LogRecord &record, const char format, const char *value);
+
+    void printBinaryArg(LogRecord &record, const char format, const __FlashStringHelper *value);
+
+    void printBinaryArg(LogRecord &record, const char format, const String &value);
+
+    void printBinaryArg(LogRecord &record, const char format, const IPAddress &value);
+
+    void printBinaryArg(LogRecord &record, const char format, const Printable &value);
+
+    void printBinaryArg(LogRecord &record, const char format, const void *value);
+
+    void printBinaryByte(LogRecord &record, uint8_t b);
+
+    void printBinaryValue(LogRecord &record, unsigned long value, uint8_t size);
+
+    void printBinaryString(LogRecord &record, const char *s, bool flash);
+#endif
+
+    template <class T, typename... Args> LOG_INLINE void printLevel(int level, T msg, const Args&... args)
+    {
+#ifndef DISABLE_LOGGING
+      if (level > Config::maxLevel)
+      {
+        return;
+      }
+      if (level > _activeLevel)
+      {
+#ifdef LOG_ENABLE_STATS
+        _stats.filtered[level - 1]++;
+#endif
+        return;
+      }
+#ifdef LOG_SAMPLING
+      if (!checkSample(level))
+      {
+        return;
+      }
+#endif
+#ifdef LOG_RATE_LIMIT
+      if (!checkRate(level, formatString(msg), isFlashString(msg)))
+      {
+        return;
+      }
+#endif
+
+      printRecord(level, NULL, msg, args...);
+#endif
+    }
+
+    template <class T, typename... Args> LOG_INLINE void printLevel(const LogTag &tag, int level, T msg, const Args&... args)
+    {
+#ifndef DISABLE_LOGGING
+      if (level > Config::maxLevel)
+      {
+        return;
+      }
+#ifdef LOG_MAX_TAGS
+      if (level > _tagActiveLevel[tag.id()])
+#else
+      if (level > _activeLevel)
+#endif
+      {
+#ifdef LOG_ENABLE_STATS
+        _stats.filtered[level - 1]++;
+#endif
+        return;
+      }
+#ifdef LOG_SAMPLING
+      if (!checkSample(level))
+      {
+        return;
+      }
+#endif
+#ifdef LOG_RATE_LIMIT
+      if (!checkRate(level, formatString(msg), isFlashString(msg)))
+      {
+        return;
+      }
+#endif
+
+      printRecord(level, tag.name(), msg, args...);
+#endif
+    }
+
+    template <class T, typename... Args> LOG_NOINLINE void printRecord(int level, const char *tagName, T msg, const Args&... args)
+    {
+#ifndef DISABLE_LOGGING
+#ifdef LOG_THREAD_SAFE
+      LogRecord record(this, false);
+#else
+      LogRecord &record = _record;
+#endif
+      formatRecord(record, level, tagName, msg, args...);
+#endif
+    }
+
+    template <class T, typename... Args> void formatRecord(LogRecord &record, int level, const char *tagName, T msg, const Args&... args)
+    {
+#ifndef DISABLE_LOGGING
+      beginRecord(record, level);
+
+#ifdef LOG_BINARY_FORMAT
+      (void)tagName;
+      printBinaryHeader(record, level, formatString(msg), isFlashString(msg), integerWidth(args...));
+      printBinaryArgs(record, formatString(msg), isFlashString(msg), args...);
+      printBinaryFooter(record);
+#else
+      printPrefix(record, level, tagName);
+      printArgs(record, formatString(msg), isFlashString(msg), args...);
+      if (_recordFormat != LOG_RECORD_TEXT)
+      {
+        endMessage(record);
+        printFields(record, args...);
+      }
+      printSuffix(record);
+#endif
+
+      endRecord(record);
+#endif
+    }
+
+#ifndef DISABLE_LOGGING
+    int _level;
+    int _activeLevel;
+    uint8_t _recordFormat;
+
+    LogOutputs _outputs;
+#ifdef LOG_RETAINED_SIZE
+    LogRetained _retained;
+#endif
+#ifdef LOG_RATE_LIMIT
+    LogRateLimiter _rate;
+#endif
+#ifdef LOG_SAMPLING
+    LogSampler _sampler;
+#endif
+#ifdef LOG_THREAD_SAFE
+    LogLock _lock;
+#else
+    LogRecord _record;
+#endif
+#ifdef LOG_ENABLE_STATS
+    LogStats _stats;
+#endif
+#ifdef LOG_MAX_TAGS
+    int8_t _tagLevel[LOG_MAX_TAGS];
+    int8_t _tagActiveLevel[LOG_MAX_TAGS];
+#endif
+#ifdef LOG_SCOPE_SIZE
+    LogContext _context;
+#endif
+#ifdef LOG_MAX_SPECIFIERS
+    struct Specifier
+    {
+      char specifier;
+      formatfunction handler;
+    };
+
+    Specifier _specifiers[LOG_MAX_SPECIFIERS];
+    uint8_t _specifierCount;
+#endif
+#ifdef LOG_ASYNC_BUFFER_SIZE
+    LogRingBuffer _ring;
+#endif
+#endif
+};
+
+/**
+   LogScope adds a context, e.g. a request id, to every record logged
+   while it exists. The context is formatted once, when the scope is
+   opened, and copied into each record after the level and tag; in JSON
+   and logfmt records it is the "scope" field. Scopes nest:
+
+       void handle(Request &request)
+       {
+         LogScope scope(Log, "req=%l", request.id);
+         Log.notice("start" CR);             // "N: req=42 start"
+         ...
+       }
+
+   Needs LOG_SCOPE_SIZE. It works with any BasicLogging configuration.
+   The context belongs to the Logging instance, so with LOG_THREAD_SAFE it
+   applies to the records of all tasks. Binary records leave it out.
+*/
+class LogScope
+{
+  public:
+    template <class Config, class T, typename... Args>
+    LogScope(BasicLogging<Config> &log, T format, const Args&... args)
+      : _log(&log), _pop(popFrom<BasicLogging<Config> >)
+    {
+      log.pushScope(format, args...);
+    }
+
+    ~LogScope() { _pop(_log); }
+
+  private:
+    typedef void (*popfunction)(void *logger);
+
+    template <class Logger>
+    static void popFrom(void *logger)
+    {
+      static_cast<Logger *>(logger)->popScope();
+    }
+
+    LogScope(const LogScope &);
+    LogScope &operator=(const LogScope &);
+
+    void *_log;
+    popfunction _pop;
+};
+
+#ifndef DISABLE_STATIC_LOG
+// The instance is a static member of a class template, so every file that
+// includes the header shares one Log, which is constructed once
+template <typename T = void>
+struct LogInstance
+{
+  static Logging log;
+};
+
+template <typename T>
+Logging LogInstance<T>::log;
+
+static Logging &Log LOG_UNUSED = LogInstance<>::log;
+
+/**
+   Logging macros for the static Log instance. Unlike the member functions,
+   these check the level before the arguments are evaluated, so nothing is
+   computed or copied for a message that is filtered out. For levels above
+   LOG_LEVEL_MAX, or when logging is disabled, the whole statement is
+   removed at compile time. With LOG_FLASH_FORMAT the format string is
+   placed in flash memory.
+*/
+#if LOG_FLASH_FORMAT
+#define LOG_FORMAT(format) F(format)
+#else
+#define LOG_FORMAT(format) format
+#endif
+
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_FATAL
+#define LOG_FATAL(format, ...)   do { if (Log.isEnabled(LOG_LEVEL_FATAL)) Log.fatal(LOG_FORMAT(format), ##__VA_ARGS__); } while (0)
+#else
+#define LOG_FATAL(format, ...)   do {} while (0)
+#endif
+
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_ERROR
+#define LOG_ERROR(format, ...)   do { if (Log.isEnabled(LOG_LEVEL_ERROR)) Log.error(LOG_FORMAT(format), ##__VA_ARGS__); } while (0)
+#else
+#define LOG_ERROR(format, ...)   do {} while (0)
+#endif
+
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_WARNING
+#define LOG_WARNING(format, ...) do { if (Log.isEnabled(LOG_LEVEL_WARNING)) Log.warning(LOG_FORMAT(format), ##__VA_ARGS__); } while (0)
+#else
+#define LOG_WARNING(format, ...) do {} while (0)
+#endif
+
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_NOTICE
+#define LOG_NOTICE(format, ...)  do { if (Log.isEnabled(LOG_LEVEL_NOTICE)) Log.notice(LOG_FORMAT(format), ##__VA_ARGS__); } while (0)
+#else
+#define LOG_NOTICE(format, ...)  do {} while (0)
+#endif
+
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_TRACE
+#define LOG_TRACE(format, ...)   do { if (Log.isEnabled(LOG_LEVEL_TRACE)) Log.trace(LOG_FORMAT(format), ##__VA_ARGS__); } while (0)
+#else
+#define LOG_TRACE(format, ...)   do {} while (0)
+#endif
+
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_VERBOSE
+#define LOG_VERBOSE(format, ...) do { if (Log.isEnabled(LOG_LEVEL_VERBOSE)) Log.verbose(LOG_FORMAT(format), ##__VA_ARGS__); } while (0)
+#else
+#define LOG_VERBOSE(format, ...) do {} while (0)
+#endif
+
+/**
+   Tagged variants of the macros above: the level check uses the level of
+   the tag, e.g. LOG_NOTICE_TAG(TAG_WIFI, "connected" CR).
+*/
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_FATAL
+#define LOG_FATAL_TAG(tag, format, ...)   do { if (Log.isEnabled(tag, LOG_LEVEL_FATAL)) Log.fatal(tag, LOG_FORMAT(format), ##__VA_ARGS__); } while (0)
+#else
+#define LOG_FATAL_TAG(tag, format, ...)   do {} while (0)
+#endif
+
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_ERROR
+#define LOG_ERROR_TAG(tag, format, ...)   do { if (Log.isEnabled(tag, LOG_LEVEL_ERROR)) Log.error(tag, LOG_FORMAT(format), ##__VA_ARGS__); } while (0)
+#else
+#define LOG_ERROR_TAG(tag, format, ...)   do {} while (0)
+#endif
+
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_WARNING
+#define LOG_WARNING_TAG(tag, format, ...) do { if (Log.isEnabled(tag, LOG_LEVEL_WARNING)) Log.warning(tag, LOG_FORMAT(format), ##__VA_ARGS__); } while (0)
+#else
+#define LOG_WARNING_TAG(tag, format, ...) do {} while (0)
+#endif
+
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_NOTICE
+#define LOG_NOTICE_TAG(tag, format, ...)  do { if (Log.isEnabled(tag, LOG_LEVEL_NOTICE)) Log.notice(tag, LOG_FORMAT(format), ##__VA_ARGS__); } while (0)
+#else
+#define LOG_NOTICE_TAG(tag, format, ...)  do {} while (0)
+#endif
+
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_TRACE
+#define LOG_TRACE_TAG(tag, format, ...)   do { if (Log.isEnabled(tag, LOG_LEVEL_TRACE)) Log.trace(tag, LOG_FORMAT(format), ##__VA_ARGS__); } while (0)
+#else
+#define LOG_TRACE_TAG(tag, format, ...)   do {} while (0)
+#endif
+
+#if !defined(DISABLE_LOGGING) && LOG_LEVEL_MAX >= LOG_LEVEL_VERBOSE
+#define LOG_VERBOSE_TAG(tag, format, ...) do { if (Log.isEnabled(tag, LOG_LEVEL_VERBOSE)) Log.verbose(tag, LOG_FORMAT(format), ##__VA_ARGS__); } while (0)
+#else
+#define LOG_VERBOSE_TAG(tag, format, ...) do {} while (0)
+#endif
+#endif  //  #ifndef DISABLE_STATIC_LOG
+
+/**
+   Runs a statement only the first time and then every n-th time it is
+   reached, e.g. LOG_EVERY_N(100, LOG_TRACE("adc %d" CR, value)). Each call
+   site keeps its own count, and the statement, including its arguments,
+   is not evaluated when skipped. n may change at runtime. The count is
+   not atomic; call sites reached from several tasks or an interrupt may
+   run the statement slightly more or less often.
+*/
+#ifndef DISABLE_LOGGING
+#define LOG_EVERY_N(n, statement) \
+  do { static uint16_t logEveryCount_ = 0; \
+       if (logEveryCount_ == 0) { statement; } \
+       if (++logEveryCount_ >= (uint16_t)(n)) logEveryCount_ = 0; } while (0)
+#else
+#define LOG_EVERY_N(n, statement) do {} while (0)
+#endif
+
+// ==== IMPLEMENTATION =======================================================
+/*
+    _   ___ ___  _   _ ___ _  _  ___  _    ___   ___
+   /_\ | _ \   \| | | |_ _| \| |/ _ \| |  / _ \ / __|
+  / _ \|   / |) | |_| || || .` | (_) | |_| (_) | (_ |
+  /_/ \_\_|_\___/ \___/|___|_|\_|\___/|____\___/ \___|
+
+  Log library for Arduino
+  version 1.0.3
+  https://github.com/thijse/Arduino-Log
+
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+
+  Permission is hereby  granted, free of charge, to any  person obtaining a copy
+  of this software and associated  documentation files (the "Software"), to deal
+  in the Software  without restriction, including without  limitation the rights
+  to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+  copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+  IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+  FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+  AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+  LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+// #include "ArduinoLog.h"
+
+inline void LogBuffer::append(const char *s, size_t n)
+{
+  if (_escape)
+  {
+    while (n-- > 0)
+    {
+      appendEscaped(*s++);
+    }
+    return;
+  }
+  while (n > 0)
+  {
+    if (_length == LOG_BUFFER_SIZE)
+    {
+      flush();
+    }
+    size_t chunk = LOG_BUFFER_SIZE - _length;
+    if (chunk > n)
+    {
+      chunk = n;
+    }
+    memcpy(_buffer + _length, s, chunk);
+    _length += chunk;
+    s += chunk;
+    n -= chunk;
+  }
+}
+
+inline void LogBuffer::append_P(const char *s)
+{
+  for (;;)
+  {
+    char c = pgm_read_byte(s++);
+    if (c == 0)
+    {
+      return;
+    }
+    append(c);
+  }
+}
+
+inline void LogBuffer::appendEscaped(char c)
+{
+  if (c == '\n')
+  {
+    if (_newlines < 0xFF)
+    {
+      _newlines++;
+    }
+    return;
+  }
+  if (c == '\r')
+  {
+    return;
+  }
+  for (; _newlines > 0; _newlines--)
+  {
+    appendRaw('\\');
+    appendRaw('n');
+  }
+  if (c == '"' || c == '\\')
+  {
+    appendRaw('\\');
+    appendRaw(c);
+  }
+  else if (c == '\t')
+  {
+    appendRaw('\\');
+    appendRaw('t');
+  }
+  else if ((uint8_t)c < 0x20)
+  {
+    appendRaw('\\');
+    appendRaw('u');
+    appendRaw('0');
+    appendRaw('0');
+    appendRaw(hexDigit((uint8_t)c >> 4));
+    appendRaw(hexDigit(c));
+  }
+  else
+  {
+    appendRaw(c);
+  }
+}
+
+inline void LogBuffer::flush()
+{
+  if (_length > 0 && _output != NULL)
+  {
+    _output->write(reinterpret_cast<const uint8_t *>(_buffer), _length);
+  }
+  _flushed += _length;
+  _length = 0;
+}
+
+// The constant tables are static members of a class template, like Log,
+// so that every file that includes the header shares one copy of each
+template <typename T = void>
+struct LogTables
+{
+  static const char digitPairs[];
+  static const uint32_t powersOfTen[LOG_MAX_PRECISION + 1];
+#ifdef LOG_BINARY_FORMAT
+  static const char hexdumpFormat[];
+#endif
+};
+
+template <typename T>
+const char LogTables<T>::digitPairs[] PROGMEM =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+inline char *LogBuffer::writeDigitPair(char *p, uint8_t value)
+{
+  p -= 2;
+  p[0] = pgm_read_byte(&LogTables<>::digitPairs[2 * value]);
+  p[1] = pgm_read_byte(&LogTables<>::digitPairs[2 * value + 1]);
+  return p;
+}
+
+inline void LogBuffer::appendUnsigned(unsigned long value, uint8_t width, char pad)
+{
+  appendNumber(value, 10, width, pad, false);
+}
+
+inline void LogBuffer::appendSigned(long value, uint8_t width, char pad)
+{
+  if (value < 0)
+  {
+    appendNumber(0UL - (unsigned long)value, 10, width, pad, true);
+  }
+  else
+  {
+    appendNumber((unsigned long)value, 10, width, pad, false);
+  }
+}
+
+inline void LogBuffer::appendHex(unsigned long value, uint8_t width, char pad)
+{
+  appendNumber(value, 16, width, pad, false);
+}
+
+inline void LogBuffer::appendBinary(unsigned long value, uint8_t width, char pad)
+{
+  appendNumber(value, 2, width, pad, false);
+}
+
+inline void LogBuffer::appendNumber(unsigned long value, uint8_t base, uint8_t width, char pad, bool negative)
+{
+  // The digits are produced from the right into a local array, which is
+  // large enough for an unsigned long in binary.
+  char digits[8 * sizeof(unsigned long)];
+  char *end = digits + sizeof(digits);
+  char *p = writeNumber(end, value, base);
+  appendDigits(p, end - p, width, pad, negative);
+}
+
+inline void LogBuffer::appendLongLong(unsigned long long value, uint8_t base, uint8_t width, char pad, bool negative)
+{
+  char digits[8 * sizeof(unsigned long long)];
+  char *end = digits + sizeof(digits);
+  char *p = end;
+
+  // Take digits off with 64 bit arithmetic until the rest fits in an
+  // unsigned long
+  while (value != (unsigned long)value)
+  {
+    if (base == 10)
+    {
+      unsigned long long quotient = value / 100;
+      p = writeDigitPair(p, (uint8_t)(value - quotient * 100));
+      value = quotient;
+    }
+    else
+    {
+      *--p = hexDigit(value & (base - 1));
+      value >>= (base == 16 ? 4 : 1);
+    }
+  }
+  p = writeNumber(p, (unsigned long)value, base);
+  appendDigits(p, end - p, width, pad, negative);
+}
+
+inline char *LogBuffer::writeNumber(char *p, unsigned long value, uint8_t base)
+{
+  if (base == 10)
+  {
+    while (value > 0xFFFF)
+    {
+      unsigned long quotient = value / 100;
+      p = writeDigitPair(p, (uint8_t)(value - quotient * 100));
+      value = quotient;
+    }
+    uint16_t small = (uint16_t)value;
+    while (small >= 100)
+    {
+      uint16_t quotient = small / 100;
+      p = writeDigitPair(p, (uint8_t)(small - quotient * 100));
+      small = quotient;
+    }
+    if (small >= 10)
+    {
+      p = writeDigitPair(p, (uint8_t)small);
+    }
+    else
+    {
+      *--p = (char)('0' + small);
+    }
+  }
+  else
+  {
+    uint8_t shift = base == 16 ? 4 : 1;
+    uint8_t mask = base - 1;
+    do
+    {
+      *--p = hexDigit(value & mask);
+      value >>= shift;
+    } while (value != 0);
+  }
+  return p;
+}
+
+inline void LogBuffer::appendDigits(const char *p, size_t length, uint8_t width, char pad, bool negative)
+{
+  size_t total = length + (negative ? 1 : 0);
+  if (negative && pad == '0')
+  {
+    append('-');
+  }
+  for (; total < width; ++total)
+  {
+    append(pad);
+  }
+  if (negative && pad != '0')
+  {
+    append('-');
+  }
+  append(p, length);
+}
+
+static_assert(LOG_FIXED_POINT_BITS >= 1 && LOG_FIXED_POINT_BITS <= 28,
+              "LOG_FIXED_POINT_BITS must be between 1 and 28");
+
+template <typename T>
+const uint32_t LogTables<T>::powersOfTen[LOG_MAX_PRECISION + 1] PROGMEM =
+{
+  1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL, 100000000UL, 1000000000UL
+};
+
+inline void LogBuffer::appendFloat(double value, uint8_t precision, uint8_t width, char pad)
+{
+  if (value != value)
+  {
+    append_P(PSTR("nan"));
+    return;
+  }
+  bool negative = value < 0;
+  if (negative)
+  {
+    value = -value;
+  }
+  if (value > 4294967040.0)
+  {
+    // Also catches infinity
+    append_P(value - value == 0 ? PSTR("ovf") : PSTR("inf"));
+    return;
+  }
+  if (precision > LOG_MAX_PRECISION)
+  {
+    precision = LOG_MAX_PRECISION;
+  }
+  uint32_t scale = pgm_read_dword(&LogTables<>::powersOfTen[precision]);
+  unsigned long integer = (unsigned long)value;
+  unsigned long fraction = (unsigned long)((value - integer) * scale + 0.5);
+  if (fraction >= scale)
+  {
+    integer++;
+    fraction -= scale;
+  }
+  appendDecimal(integer, fraction, precision, width, pad, negative);
+}
+
+inline void LogBuffer::appendFixed(unsigned long value, uint8_t bits, bool negative, uint8_t precision, uint8_t width, char pad)
+{
+  if (precision > LOG_MAX_PRECISION)
+  {
+    precision = LOG_MAX_PRECISION;
+  }
+  unsigned long integer = value >> bits;
+  unsigned long mask = (1UL << bits) - 1;
+  unsigned long rest = value & mask;
+  unsigned long fraction = 0;
+  // One decimal per step: rest stays below 2^bits, so rest * 10 fits
+  for (uint8_t i = 0; i < precision; i++)
+  {
+    rest *= 10;
+    fraction = fraction * 10 + (rest >> bits);
+    rest &= mask;
+  }
+  if (rest >= (1UL << (bits - 1)))
+  {
+    if (++fraction == pgm_read_dword(&LogTables<>::powersOfTen[precision]))
+    {
+      integer++;
+      fraction = 0;
+    }
+  }
+  appendDecimal(integer, fraction, precision, width, pad, negative);
+}
+
+inline void LogBuffer::appendDecimal(unsigned long integer, unsigned long fraction, uint8_t precision, uint8_t width, char pad, bool negative)
+{
+  uint8_t fractionWidth = precision > 0 ? precision + 1 : 0;
+  appendNumber(integer, 10, width > fractionWidth ? width - fractionWidth : 0, pad, negative);
+  if (precision > 0)
+  {
+    append('.');
+    appendNumber(fraction, 10, precision, '0', false);
+  }
+}
+
+inline size_t LogBuffer::write(uint8_t c)
+{
+  append((char)c);
+  return 1;
+}
+
+inline size_t LogBuffer::write(const uint8_t *buffer, size_t size)
+{
+  append(reinterpret_cast<const char *>(buffer), size);
+  return size;
+}
+
+#if defined(LOG_RETAINED_SIZE) && !defined(DISABLE_LOGGING)
+#define LOG_RETAINED_MAGIC 0x52544C47UL
+
+struct LogRetainedData
+{
+  uint32_t magic;
+  uint16_t head;      // where the next byte goes
+  uint16_t length;    // bytes stored, up to LOG_RETAINED_SIZE
+  uint16_t check;     // CRC of magic, head and length
+  char data[LOG_RETAINED_SIZE];
+};
+
+static_assert(LOG_RETAINED_SIZE >= 1 && LOG_RETAINED_SIZE <= 32768,
+              "LOG_RETAINED_SIZE must be between 1 and 32768");
+
+// Weak, so that all files including the header share one buffer. A weak
+// object is not in a COMDAT group, which LOG_NOINIT's section rules out.
+LogRetainedData logRetained __attribute__((weak)) LOG_NOINIT;
+
+inline void LogRetained::begin()
+{
+  if (!isValid())
+  {
+    commit(0, 0);
+  }
+}
+
+inline size_t LogRetained::dump(Print &output)
+{
+  if (!isValid())
+  {
+    commit(0, 0);
+    return 0;
+  }
+  uint16_t head = logRetained.head;
+  uint16_t length = logRetained.length;
+  uint16_t start = head >= length ? head - length : head + LOG_RETAINED_SIZE - length;
+  size_t total = 0;
+  if (start + length > LOG_RETAINED_SIZE)
+  {
+    total += output.write(reinterpret_cast<const uint8_t *>(logRetained.data + start), LOG_RETAINED_SIZE - start);
+    total += output.write(reinterpret_cast<const uint8_t *>(logRetained.data), head);
+  }
+  else
+  {
+    total += output.write(reinterpret_cast<const uint8_t *>(logRetained.data + start), length);
+  }
+  commit(0, 0);
+  return total;
+}
+
+inline size_t LogRetained::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+inline size_t LogRetained::write(const uint8_t *data, size_t size)
+{
+  size_t written = size;
+  if (size > LOG_RETAINED_SIZE)
+  {
+    data += size - LOG_RETAINED_SIZE;
+    size = LOG_RETAINED_SIZE;
+  }
+  uint16_t head = logRetained.head;
+  size_t length = logRetained.length + size;
+  while (size > 0)
+  {
+    size_t chunk = LOG_RETAINED_SIZE - head;
+    if (chunk > size)
+    {
+      chunk = size;
+    }
+    memcpy(logRetained.data + head, data, chunk);
+    head = head + chunk == LOG_RETAINED_SIZE ? 0 : head + chunk;
+    data += chunk;
+    size -= chunk;
+  }
+  commit(head, length < LOG_RETAINED_SIZE ? length : LOG_RETAINED_SIZE);
+  return written;
+}
+
+inline bool LogRetained::isValid()
+{
+  return logRetained.magic == LOG_RETAINED_MAGIC && logRetained.head < LOG_RETAINED_SIZE &&
+         logRetained.length <= LOG_RETAINED_SIZE && logRetained.check == checksum(logRetained.head, logRetained.length);
+}
+
+inline void LogRetained::commit(uint16_t head, uint16_t length)
+{
+  logRetained.magic = LOG_RETAINED_MAGIC;
+  logRetained.head = head;
+  logRetained.length = length;
+  logRetained.check = checksum(head, length);
+}
+
+inline uint16_t LogRetained::checksum(uint16_t head, uint16_t length)
+{
+  // CRC-16/CCITT, bit by bit, over the four bytes of head and length
+  uint8_t bytes[] = { (uint8_t)head, (uint8_t)(head >> 8), (uint8_t)length, (uint8_t)(length >> 8) };
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < sizeof(bytes); i++)
+  {
+    crc ^= (uint16_t)bytes[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+#endif
+
+inline void LogTimestamp::setMode(uint8_t mode, timefunction clock)
+{
+  _mode = mode;
+  _clock = clock;
+  _valid = false;
+  if (_mode == LOG_TIMESTAMP_RTC && _clock == NULL)
+  {
+    _mode = LOG_TIMESTAMP_NONE;
+  }
+}
+
+inline void LogTimestamp::printMillis(LogBuffer &buffer, bool padded)
+{
+  if (_mode != LOG_TIMESTAMP_NONE)
+  {
+    buffer.appendUnsigned(millis(), padded ? 10 : 0, ' ');
+    if (padded)
+    {
+      buffer.append(' ');
+    }
+  }
+}
+
+inline void LogTimestamp::print(LogBuffer &buffer, bool padded)
+{
+  if (_mode == LOG_TIMESTAMP_MILLIS || _mode == LOG_TIMESTAMP_MICROS)
+  {
+    buffer.appendUnsigned(_mode == LOG_TIMESTAMP_MILLIS ? millis() : micros(), padded ? 10 : 0, ' ');
+    if (padded)
+    {
+      buffer.append(' ');
+    }
+  }
+  else if (_mode == LOG_TIMESTAMP_UPTIME)
+  {
+    unsigned long now = millis();
+    unsigned long elapsed = now - _secondStart;
+    if (_valid && elapsed >= 1000 && elapsed < 60000UL)
+    {
+      uint8_t seconds = 0;
+      do
+      {
+        elapsed -= 1000;
+        seconds++;
+      } while (elapsed >= 1000);
+      _secondStart = now - elapsed;
+      advance(seconds);
+    }
+    else if (!_valid || elapsed >= 1000)
+    {
+      _seconds = now / 1000;
+      _secondStart = _seconds * 1000;
+      elapsed = now - _secondStart;
+      render();
+    }
+    buffer.append(_text, _length);
+    buffer.append('.');
+    buffer.appendUnsigned(elapsed, 3, '0');
+    if (padded)
+    {
+      buffer.append(' ');
+    }
+  }
+  else if (_mode == LOG_TIMESTAMP_RTC)
+  {
+    unsigned long now = _clock();
+    if (!_valid || now != _seconds)
+    {
+      unsigned long elapsed = now - _seconds;
+      if (_valid && elapsed < 60)
+      {
+        advance(elapsed);
+      }
+      else
+      {
+        _seconds = now;
+        render();
+      }
+    }
+    buffer.append(_text, _length);
+    if (padded)
+    {
+      buffer.append(' ');
+    }
+  }
+}
+
+inline void LogTimestamp::advance(uint8_t seconds)
+{
+  // seconds is below 60, so at most one minute carry
+  _seconds += seconds;
+  _second += seconds;
+  if (_second >= 60)
+  {
+    _second -= 60;
+    if (++_minute == 60)
+    {
+      render();
+      return;
+    }
+    LogBuffer::writeDigitPair(_text + _length - 3, _minute);
+  }
+  LogBuffer::writeDigitPair(_text + _length, _second);
+}
+
+inline void LogTimestamp::render()
+{
+  unsigned long days = 0;
+  unsigned long rest = _seconds;
+  if (_mode == LOG_TIMESTAMP_RTC)
+  {
+    days = _seconds / 86400UL;
+    rest = _seconds - days * 86400UL;
+  }
+  unsigned long hours = rest / 3600;
+  uint16_t secondsOfHour = rest - hours * 3600;
+  _minute = secondsOfHour / 60;
+  _second = secondsOfHour - _minute * 60;
+
+  char *p = _text;
+  if (_mode == LOG_TIMESTAMP_RTC)
+  {
+    // Civil date from days since 1970-01-01 (Howard Hinnant's algorithm)
+    unsigned long z = days + 719468UL;
+    unsigned long era = z / 146097UL;
+    unsigned long dayOfEra = z - era * 146097UL;
+    unsigned long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    unsigned long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    uint8_t mp = (5 * dayOfYear + 2) / 153;
+    uint8_t day = dayOfYear - (153 * mp + 2) / 5 + 1;
+    uint8_t month = mp < 10 ? mp + 3 : mp - 9;
+    uint16_t year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+    LogBuffer::writeDigitPair(p + 2, year / 100);
+    LogBuffer::writeDigitPair(p + 4, year % 100);
+    p[4] = '-';
+    LogBuffer::writeDigitPair(p + 7, month);
+    p[7] = '-';
+    LogBuffer::writeDigitPair(p + 10, day);
+    p[10] = ' ';
+    p += 11;
+  }
+
+  if (hours >= 100)
+  {
+    // Uptime over 99 hours, printed with as many digits as needed
+    char digits[8];
+    char *q = digits + sizeof(digits);
+    do
+    {
+      *--q = (char)('0' + hours % 10);
+      hours /= 10;
+    } while (hours != 0);
+    while (q < digits + sizeof(digits))
+    {
+      *p++ = *q++;
+    }
+  }
+  else
+  {
+    p = LogBuffer::writeDigitPair(p + 2, hours) + 2;
+  }
+  *p++ = ':';
+  p = LogBuffer::writeDigitPair(p + 2, _minute) + 2;
+  *p++ = ':';
+  p = LogBuffer::writeDigitPair(p + 2, _second) + 2;
+  _length = p - _text;
+  _valid = true;
+}
+
+#ifdef LOG_SAMPLING
+inline LogSampler::LogSampler()
+  : _state(0x2545F491)
+{
+  memset(_rates, 0, sizeof(_rates));
+}
+
+inline void LogSampler::setRate(uint8_t level, uint16_t rate, bool random)
+{
+  Rate &entry = _rates[level - 1];
+  entry.rate = rate;
+  entry.count = 0;
+  entry.random = random;
+}
+
+inline bool LogSampler::take(Rate &entry)
+{
+  if (entry.random)
+  {
+    // xorshift32; the top 16 bits scaled to 0..rate-1 avoid a division
+    uint32_t x = _state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    _state = x != 0 ? x : 0x2545F491;
+    return (((x >> 16) * entry.rate) >> 16) == 0;
+  }
+  uint16_t count = entry.count;
+  entry.count = count + 1 < entry.rate ? count + 1 : 0;
+  return count == 0;
+}
+#endif
+
+#ifdef LOG_RATE_LIMIT
+inline LogRateLimiter::LogRateLimiter()
+  : _burst(10),
+    _interval(1000),
+    _pending(0)
+{
+  memset(_entries, 0, sizeof(_entries));
+}
+
+inline void LogRateLimiter::setLimit(uint8_t burst, uint16_t interval)
+{
+  _burst = burst;
+  _interval = interval > 0 ? interval : 1;
+  memset(_entries, 0, sizeof(_entries));
+  _pending = 0;
+}
+
+inline void LogRateLimiter::refill(Entry &entry, unsigned long now)
+{
+  unsigned long elapsed = now - entry.refilled;
+  if (elapsed < _interval)
+  {
+    return;
+  }
+  unsigned long tokens = entry.tokens + elapsed / _interval;
+  if (tokens >= _burst)
+  {
+    entry.tokens = _burst;
+    entry.refilled = now;
+  }
+  else
+  {
+    entry.tokens = tokens;
+    entry.refilled = now - elapsed % _interval;
+  }
+}
+
+inline bool LogRateLimiter::allow(const char *format, bool flash, uint8_t level)
+{
+  if (_burst == 0)
+  {
+    return true;
+  }
+  unsigned long now = millis();
+
+  Entry *entry = NULL;
+  Entry *oldest = &_entries[0];
+  for (uint8_t i = 0; i < LOG_RATE_LIMIT; i++)
+  {
+    if (_entries[i].format == format)
+    {
+      entry = &_entries[i];
+      break;
+    }
+    if (_entries[i].format == NULL || now - _entries[i].refilled > now - oldest->refilled)
+    {
+      oldest = &_entries[i];
+    }
+  }
+  if (entry == NULL)
+  {
+    entry = oldest;
+    if (entry->suppressed > 0 || entry->summary > 0)
+    {
+      _pending--;
+    }
+    entry->format = format;
+    entry->flash = flash;
+    entry->refilled = now;
+    entry->suppressed = 0;
+    entry->summary = 0;
+    entry->tokens = _burst;
+  }
+  else
+  {
+    refill(*entry, now);
+  }
+
+  entry->level = level;
+  if (entry->tokens > 0)
+  {
+    // The summary goes out with this message, before the next one can
+    // take the token of the following interval
+    entry->tokens--;
+    moveToSummary(*entry);
+    return true;
+  }
+  if (entry->suppressed == 0 && entry->summary == 0)
+  {
+    _pending++;
+  }
+  if (entry->suppressed < 0xFFFF)
+  {
+    entry->suppressed++;
+  }
+  return false;
+}
+
+inline bool LogRateLimiter::takeSummary(const char *&format, bool &flash, uint8_t &level, uint16_t &count)
+{
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < LOG_RATE_LIMIT; i++)
+  {
+    Entry &entry = _entries[i];
+    if (entry.summary == 0 && entry.suppressed > 0)
+    {
+      // A call site that stopped logging gets its summary once its
+      // bucket has a token again
+      refill(entry, now);
+      if (entry.tokens > 0)
+      {
+        moveToSummary(entry);
+      }
+    }
+    if (entry.summary > 0)
+    {
+      format = entry.format;
+      flash = entry.flash;
+      level = entry.level;
+      count = entry.summary;
+      entry.summary = 0;
+      if (entry.suppressed == 0)
+      {
+        _pending--;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+inline size_t LogSummaryText::printTo(Print &output) const
+{
+  size_t length = 0;
+  while (at(length) != 0)
+  {
+    length++;
+  }
+  while (length > 0 && (at(length - 1) == '\r' || at(length - 1) == '\n'))
+  {
+    length--;
+  }
+  for (size_t i = 0; i < length; i++)
+  {
+    output.write((uint8_t)at(i));
+  }
+  return length;
+}
+
+inline void LogRateLimiter::moveToSummary(Entry &entry)
+{
+  unsigned long count = (unsigned long)entry.summary + entry.suppressed;
+  entry.summary = count < 0xFFFF ? count : 0xFFFF;
+  entry.suppressed = 0;
+}
+#endif
+
+static_assert(LOG_MAX_OUTPUTS >= 1 && LOG_MAX_OUTPUTS <= 8,
+              "LOG_MAX_OUTPUTS must be between 1 and 8");
+
+inline void LogOutputs::setPrimary(Print *output, bool sink)
+{
+  if (_count == 0)
+  {
+    _count = 1;
+  }
+  _entries[0].output = output;
+  _entries[0].level = LOG_LEVEL_VERBOSE;
+  _entries[0].showLevel = true;
+  _entries[0].sink = sink;
+  updateSinks();
+}
+
+inline bool LogOutputs::add(Print *output, int level, bool showLevel, bool sink)
+{
+  if (_count == 0)
+  {
+    // Entry 0 is kept for the primary output, even while there is none
+    _entries[0].output = NULL;
+    _entries[0].sink = false;
+    _count = 1;
+  }
+  if (_count == LOG_MAX_OUTPUTS)
+  {
+    return false;
+  }
+  _entries[_count].output = output;
+  _entries[_count].level = constrain(level, LOG_LEVEL_SILENT, LOG_LEVEL_VERBOSE);
+  _entries[_count].showLevel = showLevel;
+  _entries[_count].sink = sink;
+  _count++;
+  updateSinks();
+  return true;
+}
+
+inline void LogOutputs::updateSinks()
+{
+  _sinks = 0;
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_entries[i].sink && _entries[i].output != NULL)
+    {
+      _sinks |= 1 << i;
+    }
+  }
+}
+
+inline void LogOutputs::notifySinks(bool begin)
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_sinks & _mask & (1 << i))
+    {
+      LogSink *sink = static_cast<LogSink *>(_entries[i].output);
+      if (begin)
+      {
+        sink->beginRecord(_level);
+      }
+      else
+      {
+        sink->endRecord(_level);
+      }
+    }
+  }
+}
+
+inline bool LogOutputs::remove(Print *output)
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_entries[i].output == output)
+    {
+      if (i == 0)
+      {
+        // The primary entry stays in place for the next setPrimary()
+        _entries[0].output = NULL;
+        _entries[0].sink = false;
+      }
+      else
+      {
+        for (; i + 1 < _count; i++)
+        {
+          _entries[i] = _entries[i + 1];
+        }
+        _count--;
+      }
+      updateSinks();
+      return true;
+    }
+  }
+  return false;
+}
+
+inline bool LogOutputs::setLevel(Print *output, int level)
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_entries[i].output == output)
+    {
+      _entries[i].level = constrain(level, LOG_LEVEL_SILENT, LOG_LEVEL_VERBOSE);
+      return true;
+    }
+  }
+  return false;
+}
+
+inline int LogOutputs::getMaxLevel() const
+{
+  int level = LOG_LEVEL_SILENT;
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_entries[i].output != NULL && _entries[i].level > level)
+    {
+      level = _entries[i].level;
+    }
+  }
+  return level;
+}
+
+inline uint8_t LogOutputs::getMask(int level) const
+{
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_entries[i].output != NULL && level <= _entries[i].level)
+    {
+      mask |= 1 << i;
+    }
+  }
+  return mask;
+}
+
+inline size_t LogOutputs::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+inline size_t LogOutputs::write(const uint8_t *buffer, size_t size)
+{
+  // Part of this chunk that holds the level tag, for outputs without it
+  size_t tagStart = size;
+  size_t tagEnd = size;
+  if (_tagOffset != LOG_NO_TAG && _tagOffset < _offset + size && _tagOffset + LOG_TAG_LENGTH > _offset)
+  {
+    tagStart = _tagOffset > _offset ? _tagOffset - _offset : 0;
+    tagEnd = _tagOffset + LOG_TAG_LENGTH - _offset;
+    if (tagEnd > size)
+    {
+      tagEnd = size;
+    }
+  }
+
+#ifdef LOG_ENABLE_STATS
+  unsigned long start = micros();
+#endif
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (!(_mask & (1 << i)))
+    {
+      continue;
+    }
+    Print *output = _entries[i].output;
+    if (_entries[i].showLevel || tagStart == size)
+    {
+      output->write(buffer, size);
+#ifdef LOG_ENABLE_STATS
+      _bytesWritten += size;
+#endif
+    }
+    else
+    {
+      if (tagStart > 0)
+      {
+        output->write(buffer, tagStart);
+      }
+      if (tagEnd < size)
+      {
+        output->write(buffer + tagEnd, size - tagEnd);
+      }
+#ifdef LOG_ENABLE_STATS
+      _bytesWritten += size - (tagEnd - tagStart);
+#endif
+    }
+  }
+#ifdef LOG_ENABLE_STATS
+  _outputMicros += micros() - start;
+#endif
+  _offset += size;
+  return size;
+}
+
+#ifdef LOG_ASYNC_BUFFER_SIZE
+static_assert((LOG_ASYNC_BUFFER_SIZE & (LOG_ASYNC_BUFFER_SIZE - 1)) == 0,
+              "LOG_ASYNC_BUFFER_SIZE must be a power of two");
+static_assert(LOG_ASYNC_BUFFER_SIZE <= 32768,
+              "LOG_ASYNC_BUFFER_SIZE must not exceed 32768");
+
+inline LogRingBuffer::LogRingBuffer()
+  : _head(0),
+    _tail(0),
+    _drainRemaining(0),
+    _pending(0),
+    _recordStart(0),
+    _recordFailed(false),
+    _consumerActive(false),
+    _policy(LOG_OVERFLOW_DROP_NEWEST),
+    _recordPolicy(LOG_OVERFLOW_DROP_NEWEST),
+    _dropped(0),
+    _output(NULL)
+{
+}
+
+inline void LogRingBuffer::beginRecord(uint8_t policy)
+{
+  _recordPolicy = policy;
+  _recordStart = _head;
+  _pending = _head;
+  _recordFailed = !reserve(HEADER);
+  _pending = (_pending + HEADER) & MASK;
+}
+
+inline bool LogRingBuffer::commitRecord(uint8_t mask, uint8_t tagOffset, uint8_t level)
+{
+  if (_recordFailed)
+  {
+    _dropped++;
+    return false;
+  }
+  uint16_t length = (_pending - _recordStart - HEADER) & MASK;
+  _data[_recordStart] = length >> 8;
+  _data[(_recordStart + 1) & MASK] = length & 0xFF;
+  _data[(_recordStart + 2) & MASK] = mask;
+  _data[(_recordStart + 3) & MASK] = tagOffset;
+  _data[(_recordStart + 4) & MASK] = level;
+  LOG_MEMORY_BARRIER();
+  _head = _pending;
+  return true;
+}
+
+inline size_t LogRingBuffer::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+inline size_t LogRingBuffer::write(const uint8_t *buffer, size_t size)
+{
+  if (_recordFailed)
+  {
+    return size;
+  }
+  if (!reserve(size))
+  {
+    _recordFailed = true;
+    return size;
+  }
+  for (size_t i = 0; i < size; i++)
+  {
+    _data[_pending] = buffer[i];
+    _pending = (_pending + 1) & MASK;
+  }
+  return size;
+}
+
+inline bool LogRingBuffer::reserve(size_t n)
+{
+  while (freeSpace() < n)
+  {
+    if (_head == _tail && _drainRemaining == 0)
+    {
+      // Nothing committed is left to make room for this record
+      return false;
+    }
+    if (_recordPolicy == LOG_OVERFLOW_DROP_OLDEST)
+    {
+      if (!dropOldest())
+      {
+        return false;
+      }
+    }
+    else if (_recordPolicy == LOG_OVERFLOW_BLOCK)
+    {
+#if defined(ESP32)
+      if (_consumerActive)
+      {
+        vTaskDelay(1);
+        continue;
+      }
+#endif
+      drain(n - freeSpace());
+    }
+    else
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline bool LogRingBuffer::dropOldest()
+{
+  if (_drainRemaining > 0)
+  {
+    // Cut the record that is currently being drained
+    _tail = (_tail + _drainRemaining) & MASK;
+    _drainRemaining = 0;
+    if (_output != NULL)
+    {
+      _output->endRecord();
+    }
+  }
+  else if (_head != _tail)
+  {
+    uint16_t length = (_data[_tail] << 8) | _data[(_tail + 1) & MASK];
+    _tail = (_tail + HEADER + length) & MASK;
+  }
+  else
+  {
+    return false;
+  }
+  _dropped++;
+  return true;
+}
+
+inline size_t LogRingBuffer::drain(size_t maxBytes)
+{
+  size_t written = 0;
+  while (written < maxBytes)
+  {
+    uint16_t tail = _tail;
+    if (_drainRemaining == 0)
+    {
+      if (tail == _head)
+      {
+        break;
+      }
+      LOG_MEMORY_BARRIER();
+      _drainRemaining = (_data[tail] << 8) | _data[(tail + 1) & MASK];
+      if (_output != NULL)
+      {
+        _output->beginRecord(_data[(tail + 2) & MASK], _data[(tail + 3) & MASK], _data[(tail + 4) & MASK]);
+        if (_drainRemaining == 0)
+        {
+          _output->endRecord();
+        }
+      }
+      tail = (tail + HEADER) & MASK;
+      _tail = tail;
+      continue;
+    }
+    size_t chunk = LOG_ASYNC_BUFFER_SIZE - tail;
+    if (chunk > _drainRemaining)
+    {
+      chunk = _drainRemaining;
+    }
+    if (chunk > maxBytes - written)
+    {
+      chunk = maxBytes - written;
+    }
+    if (_output != NULL)
+    {
+      _output->write(_data + tail, chunk);
+    }
+    written += chunk;
+    _drainRemaining -= chunk;
+    if (_drainRemaining == 0 && _output != NULL)
+    {
+      _output->endRecord();
+    }
+    LOG_MEMORY_BARRIER();
+    _tail = (tail + chunk) & MASK;
+  }
+  return written;
+}
+#endif
+
+#ifdef LOG_THREAD_SAFE
+static_assert(LOG_BUFFER_SIZE >= 32,
+              "LOG_THREAD_SAFE needs a LOG_BUFFER_SIZE of at least 32");
+
+inline LogLock::LogLock()
+{
+#ifdef LOG_ASYNC_BUFFER_SIZE
+#if defined(ESP32)
+  portMUX_INITIALIZE(&_mux);
+#elif defined(ARDUINO_ARCH_RP2040)
+  memset(&_section, 0, sizeof(_section));
+#endif
+#else
+#if defined(ARDUINO_ARCH_RP2040)
+  memset(&_mutex, 0, sizeof(_mutex));
+#elif defined(ESP32) || defined(INC_FREERTOS_H)
+  _mutex = NULL;
+#endif
+#endif
+}
+
+inline void LogLock::begin()
+{
+#ifdef LOG_ASYNC_BUFFER_SIZE
+#if defined(ARDUINO_ARCH_RP2040)
+  if (!critical_section_is_initialized(&_section))
+  {
+    critical_section_init(&_section);
+  }
+#endif
+#else
+#if defined(ARDUINO_ARCH_RP2040)
+  if (!mutex_is_initialized(&_mutex))
+  {
+    mutex_init(&_mutex);
+  }
+#elif defined(ESP32) || defined(INC_FREERTOS_H)
+  if (_mutex == NULL)
+  {
+    _mutex = xSemaphoreCreateMutex();
+  }
+#endif
+#endif
+}
+
+inline void LogLock::lock()
+{
+#ifdef LOG_ASYNC_BUFFER_SIZE
+#if defined(ESP32)
+  portENTER_CRITICAL(&_mux);
+#elif defined(ARDUINO_ARCH_RP2040)
+  critical_section_enter_blocking(&_section);
+#elif defined(INC_FREERTOS_H)
+  taskENTER_CRITICAL();
+#elif defined(__AVR__)
+  uint8_t sreg = SREG;
+  cli();
+  _sreg = sreg;
+#else
+  noInterrupts();
+#endif
+#else
+#if defined(ARDUINO_ARCH_RP2040)
+  mutex_enter_blocking(&_mutex);
+#elif defined(ESP32) || defined(INC_FREERTOS_H)
+  if (_mutex != NULL)
+  {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+  }
+#endif
+#endif
+}
+
+inline void LogLock::unlock()
+{
+#ifdef LOG_ASYNC_BUFFER_SIZE
+#if defined(ESP32)
+  portEXIT_CRITICAL(&_mux);
+#elif defined(ARDUINO_ARCH_RP2040)
+  critical_section_exit(&_section);
+#elif defined(INC_FREERTOS_H)
+  taskEXIT_CRITICAL();
+#elif defined(__AVR__)
+  SREG = _sreg;
+#else
+  interrupts();
+#endif
+#else
+#if defined(ARDUINO_ARCH_RP2040)
+  mutex_exit(&_mutex);
+#elif defined(ESP32) || defined(INC_FREERTOS_H)
+  if (_mutex != NULL)
+  {
+    xSemaphoreGive(_mutex);
+  }
+#endif
+#endif
+}
+
+#ifdef LOG_ASYNC_BUFFER_SIZE
+inline bool LogLock::tryLockFromISR()
+{
+#if defined(ESP32)
+  return portTRY_ENTER_CRITICAL_ISR(&_mux, 0) == pdPASS;
+#elif defined(ARDUINO_ARCH_RP2040)
+  // Held by the other core only while it copies a record
+  critical_section_enter_blocking(&_section);
+  return true;
+#elif defined(INC_FREERTOS_H)
+  _isrState = taskENTER_CRITICAL_FROM_ISR();
+  return true;
+#else
+  // Interrupts are disabled in the handler, and other code holds the
+  // lock only with interrupts disabled
+  return true;
+#endif
+}
+
+inline void LogLock::unlockFromISR()
+{
+#if defined(ESP32)
+  portEXIT_CRITICAL_ISR(&_mux);
+#elif defined(ARDUINO_ARCH_RP2040)
+  critical_section_exit(&_section);
+#elif defined(INC_FREERTOS_H)
+  taskEXIT_CRITICAL_FROM_ISR(_isrState);
+#endif
+}
+#endif
+#endif
+
+template <class Config>
+inline void BasicLogging<Config>::begin(int level, Print* logOutput, bool showLevel)
+{
+#ifndef DISABLE_LOGGING
+#ifdef LOG_THREAD_SAFE
+  _lock.begin();
+#endif
+  setLevel(level);
+  setShowLevel(showLevel);
+  setOutput(logOutput);
+#endif
+}
+
+template <class Config>
+inline void BasicLogging<Config>::begin(int level, LogSink *logOutput, bool showLevel)
+{
+#ifndef DISABLE_LOGGING
+  begin(level, static_cast<Print *>(logOutput), showLevel);
+  setOutput(logOutput);
+#endif
+}
+
+template <class Config>
+inline void BasicLogging<Config>::setLevel(int level)
+{
+#ifndef DISABLE_LOGGING
+  _level = constrain(level, LOG_LEVEL_SILENT, LOG_LEVEL_MAX);
+  updateActiveLevel();
+#endif
+}
+
+template <class Config>
+inline int BasicLogging<Config>::getLevel() const
+{
+#ifndef DISABLE_LOGGING
+  return _level;
+#else
+  return 0;
+#endif
+}
+
+#ifdef LOG_MAX_TAGS
+template <class Config>
+inline void BasicLogging<Config>::setTagLevel(const LogTag &tag, int level)
+{
+#ifndef DISABLE_LOGGING
+  if (tag.id() >= LOG_MAX_TAGS)
+  {
+    return;
+  }
+  if (level != LOG_LEVEL_INHERIT)
+  {
+    level = constrain(level, LOG_LEVEL_SILENT, LOG_LEVEL_MAX);
+  }
+  _tagLevel[tag.id()] = level;
+  updateActiveLevel();
+#endif
+}
+
+template <class Config>
+inline int BasicLogging<Config>::getTagLevel(const LogTag &tag) const
+{
+#ifndef DISABLE_LOGGING
+  if (tag.id() >= LOG_MAX_TAGS || _tagLevel[tag.id()] == LOG_LEVEL_INHERIT)
+  {
+    return _level;
+  }
+  return _tagLevel[tag.id()];
+#else
+  return 0;
+#endif
+}
+#endif
+
+#ifdef LOG_MAX_SPECIFIERS
+template <class Config>
+inline bool BasicLogging<Config>::addSpecifier(char specifier, formatfunction handler)
+{
+#ifndef DISABLE_LOGGING
+  if (specifier == 0 || specifier == '%' || specifier == '.' || (specifier >= '0' && specifier <= '9') || handler == NULL)
+  {
+    return false;
+  }
+  for (uint8_t i = 0; i < _specifierCount; i++)
+  {
+    if (_specifiers[i].specifier == specifier)
+    {
+      _specifiers[i].handler = handler;
+      return true;
+    }
+  }
+  if (_specifierCount == LOG_MAX_SPECIFIERS)
+  {
+    return false;
+  }
+  _specifiers[_specifierCount].specifier = specifier;
+  _specifiers[_specifierCount].handler = handler;
+  _specifierCount++;
+  return true;
+#else
+  (void)specifier;
+  (void)handler;
+  return false;
+#endif
+}
+#endif
+
+template <class Config>
+inline void BasicLogging<Config>::setOutput(Print* output)
+{
+#ifndef DISABLE_LOGGING
+  _outputs.setPrimary(output);
+#ifdef LOG_ASYNC_BUFFER_SIZE
+  _ring.setOutput(&_outputs);
+#endif
+#ifndef LOG_THREAD_SAFE
+#ifdef LOG_ASYNC_BUFFER_SIZE
+  _record.buffer.setOutput(&_ring);
+#else
+  _record.buffer.setOutput(&_outputs);
+#endif
+#endif
+  updateActiveLevel();
+#endif
+}
+
+template <class Config>
+inline void BasicLogging<Config>::setOutput(LogSink *output)
+{
+#ifndef DISABLE_LOGGING
+  setOutput(static_cast<Print *>(output));
+  _outputs.setPrimary(output, true);
+#endif
+}
+
+template <class Config>
+inline bool BasicLogging<Config>::addOutput(Print *output, int level, bool showLevel)
+{
+#ifndef DISABLE_LOGGING
+  if (!_outputs.add(output, level, showLevel))
+  {
+    return false;
+  }
+  updateActiveLevel();
+  return true;
+#else
+  return false;
+#endif
+}
+
+template <class Config>
+inline bool BasicLogging<Config>::addOutput(LogSink *output, int level, bool showLevel)
+{
+#ifndef DISABLE_LOGGING
+  if (!_outputs.add(output, level, showLevel, true))
+  {
+    return false;
+  }
+  updateActiveLevel();
+  return true;
+#else
+  return false;
+#endif
+}
+
+template <class Config>
+inline bool BasicLogging<Config>::removeOutput(Print *output)
+{
+#ifndef DISABLE_LOGGING
+  if (!_outputs.remove(output))
+  {
+    return false;
+  }
+  updateActiveLevel();
+  return true;
+#else
+  return false;
+#endif
+}
+
+#ifdef LOG_RETAINED_SIZE
+template <class Config>
+inline bool BasicLogging<Config>::setFlightRecorder(int level)
+{
+#ifndef DISABLE_LOGGING
+  if (level <= LOG_LEVEL_SILENT)
+  {
+    removeOutput(&_retained);
+    return true;
+  }
+  if (setOutputLevel(&_retained, level))
+  {
+    return true;
+  }
+  _retained.begin();
+  return addOutput(&_retained, level, true);
+#else
+  return false;
+#endif
+}
+
+template <class Config>
+inline size_t BasicLogging<Config>::dumpRetained(Print &output)
+{
+#ifndef DISABLE_LOGGING
+  return _retained.dump(output);
+#else
+  return 0;
+#endif
+}
+#endif
+
+template <class Config>
+inline bool BasicLogging<Config>::setOutputLevel(Print *output, int level)
+{
+#ifndef DISABLE_LOGGING
+  if (!_outputs.setLevel(output, level))
+  {
+    return false;
+  }
+  updateActiveLevel();
+  return true;
+#else
+  return false;
+#endif
+}
+
+template <class Config>
+inline void BasicLogging<Config>::setShowLevel(bool showLevel)
+{
+#ifndef DISABLE_LOGGING
+  this->setShowsLevel(showLevel);
+#endif
+}
+
+template <class Config>
+inline bool BasicLogging<Config>::getShowLevel() const
+{
+#ifndef DISABLE_LOGGING
+  return this->showsLevel();
+#else
+  return false;
+#endif
+}
+
+template <class Config>
+inline void BasicLogging<Config>::setPrefix(printfunction f)
+{
+#ifndef DISABLE_LOGGING
+  static_assert(Config::prefix, "setPrefix() needs prefix in the LogConfig");
+  this->setPrefixFunction(f);
+#endif
+}
+
+template <class Config>
+inline void BasicLogging<Config>::setSuffix(printfunction f)
+{
+#ifndef DISABLE_LOGGING
+  static_assert(Config::prefix, "setSuffix() needs prefix in the LogConfig");
+  this->setSuffixFunction(f);
+#endif
+}
+
+template <class Config>
+inline void BasicLogging<Config>::setTimestamp(uint8_t mode, timefunction clock)
+{
+#ifndef DISABLE_LOGGING
+  static_assert(Config::timestamp, "setTimestamp() needs timestamp in the LogConfig");
+  this->timestamp().setMode(mode, clock);
+#endif
+}
+
+template <class Config>
+inline void BasicLogging<Config>::setRecordFormat(uint8_t format)
+{
+#ifndef DISABLE_LOGGING
+  _recordFormat = format;
+#endif
+}
+
+#ifdef LOG_RATE_LIMIT
+template <class Config>
+inline void BasicLogging<Config>::setRateLimit(uint8_t burst, uint16_t interval)
+{
+#ifndef DISABLE_LOGGING
+  _rate.setLimit(burst, interval);
+#endif
+}
+#endif
+
+#ifdef LOG_SAMPLING
+template <class Config>
+inline void BasicLogging<Config>::setSampleRate(int level, uint16_t rate, bool random)
+{
+#ifndef DISABLE_LOGGING
+  if (level > LOG_LEVEL_SILENT && level <= LOG_LEVEL_VERBOSE)
+  {
+    _sampler.setRate(level, rate, random);
+  }
+#endif
+}
+#endif
+
+#ifdef LOG_RATE_LIMIT
+#ifndef DISABLE_LOGGING
+template <class Config>
+inline bool BasicLogging<Config>::checkRate(int level, const char *format, bool flash)
+{
+#ifdef LOG_THREAD_SAFE
+  _lock.lock();
+#endif
+  bool allowed = _rate.allow(format, flash, level);
+#ifdef LOG_THREAD_SAFE
+  _lock.unlock();
+#endif
+#ifdef LOG_ENABLE_STATS
+  if (!allowed)
+  {
+    _stats.suppressed++;
+  }
+#endif
+
+  // Summaries of call sites whose burst has ended come before this record
+  while (_rate.hasPending())
+  {
+    const char *summaryFormat;
+    bool summaryFlash;
+    uint8_t summaryLevel;
+    uint16_t count;
+#ifdef LOG_THREAD_SAFE
+    _lock.lock();
+#endif
+    bool found = _rate.takeSummary(summaryFormat, summaryFlash, summaryLevel, count);
+#ifdef LOG_THREAD_SAFE
+    _lock.unlock();
+#endif
+    if (!found)
+    {
+      break;
+    }
+#ifdef LOG_BINARY_FORMAT
+    // The decoder ends the line of every record
+    if (summaryFlash)
+    {
+      printRecord(summaryLevel, NULL, F("suppressed %u messages: %P"), count, summaryFormat);
+    }
+    else
+    {
+      printRecord(summaryLevel, NULL, F("suppressed %u messages: %s"), count, summaryFormat);
+    }
+#else
+    printRecord(summaryLevel, NULL, F("suppressed %u messages: %S" CR), count, LogSummaryText(summaryFormat, summaryFlash));
+#endif
+  }
+  return allowed;
+}
+#endif
+#endif
+
+#ifndef DISABLE_LOGGING
+template <class Config>
+inline void BasicLogging<Config>::updateActiveLevel()
+{
+  int outputLevel = _outputs.getMaxLevel();
+  _activeLevel = _level < outputLevel ? _level : outputLevel;
+#ifdef LOG_MAX_TAGS
+  for (uint8_t i = 0; i < LOG_MAX_TAGS; i++)
+  {
+    int level = _tagLevel[i] == LOG_LEVEL_INHERIT ? _level : _tagLevel[i];
+    _tagActiveLevel[i] = level < outputLevel ? level : outputLevel;
+  }
+#endif
+}
+
+template <class Config>
+inline void BasicLogging<Config>::beginRecord(LogRecord &record, int level)
+{
+#ifdef LOG_ENABLE_STATS
+  _stats.emitted[level - 1]++;
+  record.startMicros = micros();
+  record.startOutputMicros = _outputs.getOutputMicros();
+#endif
+  record.mask = _outputs.getMask(level);
+  record.level = level;
+  record.tagOffset = LOG_NO_TAG;
+  record.buffer.beginRecord();
+#ifdef LOG_THREAD_SAFE
+  record.published = false;
+  record.failed = false;
+#else
+#ifdef LOG_ASYNC_BUFFER_SIZE
+  _ring.beginRecord();
+#else
+  _outputs.beginRecord(record.mask, LOG_NO_TAG, level);
+#endif
+#endif
+}
+
+template <class Config>
+inline void BasicLogging<Config>::endRecord(LogRecord &record)
+{
+  record.buffer.flush();
+#ifdef LOG_THREAD_SAFE
+  if (!record.published)
+  {
+    publishRecord(record);
+  }
+  if (record.failed)
+  {
+#ifdef LOG_ASYNC_BUFFER_SIZE
+    _ring.addDropped();
+#endif
+    return;
+  }
+#endif
+#ifdef LOG_ASYNC_BUFFER_SIZE
+  if (!_ring.commitRecord(record.mask, record.tagOffset, record.level))
+  {
+#ifdef LOG_THREAD_SAFE
+    record.failed = true;
+#endif
+  }
+#else
+  _outputs.endRecord();
+#endif
+#ifdef LOG_ENABLE_STATS
+  // Output time spent while flushing is accounted in outputMicros only
+  uint32_t outputMicros = _outputs.getOutputMicros() - record.startOutputMicros;
+  _stats.formatMicros += (micros() - record.startMicros) - outputMicros;
+#endif
+#ifdef LOG_THREAD_SAFE
+#ifdef LOG_ASYNC_BUFFER_SIZE
+  if (record.fromISR)
+  {
+    _lock.unlockFromISR();
+    return;
+  }
+#endif
+  _lock.unlock();
+#endif
+}
+
+#ifdef LOG_THREAD_SAFE
+template <class Config>
+inline void BasicLogging<Config>::publishRecord(LogRecord &record)
+{
+  record.published = true;
+#ifdef LOG_ASYNC_BUFFER_SIZE
+  uint8_t policy = _ring.getOverflowPolicy();
+  if (record.fromISR)
+  {
+    if (!_lock.tryLockFromISR())
+    {
+      record.failed = true;
+      return;
+    }
+    // An interrupt must neither wait nor move the consumer's tail
+    policy = LOG_OVERFLOW_DROP_NEWEST;
+  }
+  else
+  {
+    _lock.lock();
+    if (policy == LOG_OVERFLOW_BLOCK)
+    {
+      // Waiting for the drain task inside the critical section would
+      // stall it forever
+      policy = LOG_OVERFLOW_DROP_NEWEST;
+    }
+  }
+  _ring.beginRecord(policy);
+#else
+  _lock.lock();
+  _outputs.beginRecord(record.mask, record.tagOffset, record.level);
+#endif
+}
+
+template <class Config>
+inline size_t BasicLogging<Config>::publish(LogRecord &record, const uint8_t *buffer, size_t size)
+{
+  if (!record.published)
+  {
+    publishRecord(record);
+  }
+  if (record.failed)
+  {
+    return size;
+  }
+#ifdef LOG_ASYNC_BUFFER_SIZE
+  return _ring.write(buffer, size);
+#else
+  return _outputs.write(buffer, size);
+#endif
+}
+
+inline size_t LogPublisher::write(uint8_t c)
+{
+  return _publish(_logger, *_record, &c, 1);
+}
+
+inline size_t LogPublisher::write(const uint8_t *buffer, size_t size)
+{
+  return _publish(_logger, *_record, buffer, size);
+}
+#endif
+#endif
+
+#ifdef LOG_ENABLE_STATS
+template <class Config>
+inline LogStats BasicLogging<Config>::getStats() const
+{
+  LogStats stats;
+#ifndef DISABLE_LOGGING
+  stats = _stats;
+  stats.bytesWritten = _outputs.getBytesWritten();
+  stats.outputMicros = _outputs.getOutputMicros();
+#ifdef LOG_ASYNC_BUFFER_SIZE
+  stats.dropped = _ring.getDroppedCount();
+#endif
+#else
+  memset(&stats, 0, sizeof(stats));
+#endif
+  return stats;
+}
+
+template <class Config>
+inline void BasicLogging<Config>::resetStats()
+{
+#ifndef DISABLE_LOGGING
+  memset(&_stats, 0, sizeof(_stats));
+  _outputs.resetStats();
+#ifdef LOG_ASYNC_BUFFER_SIZE
+  _ring.resetDroppedCount();
+#endif
+#endif
+}
+#endif
+
+template <class Config>
+inline void BasicLogging<Config>::hexdump(int level, const void *data, size_t length)
+{
+#ifndef DISABLE_LOGGING
+  printHexdump(level, static_cast<const uint8_t *>(data), length, false);
+#endif
+}
+
+template <class Config>
+inline void BasicLogging<Config>::hexdump_P(int level, const void *data, size_t length)
+{
+#ifndef DISABLE_LOGGING
+  printHexdump(level, static_cast<const uint8_t *>(data), length, true);
+#endif
+}
+
+#ifndef DISABLE_LOGGING
+static_assert(LOG_HEXDUMP_WIDTH >= 1 && LOG_HEXDUMP_WIDTH <= 64,
+              "LOG_HEXDUMP_WIDTH must be between 1 and 64");
+
+#ifdef LOG_BINARY_FORMAT
+template <typename T>
+const char LogTables<T>::hexdumpFormat[] PROGMEM = "%H";
+#endif
+
+template <class Config>
+inline void BasicLogging<Config>::printHexdump(int level, const uint8_t *data, size_t length, bool flash)
+{
+  if (level <= LOG_LEVEL_SILENT || level > Config::maxLevel)
+  {
+    return;
+  }
+  if (level > _activeLevel)
+  {
+#ifdef LOG_ENABLE_STATS
+    _stats.filtered[level - 1]++;
+#endif
+    return;
+  }
+#ifdef LOG_SAMPLING
+  if (!checkSample(level))
+  {
+    return;
+  }
+#endif
+
+#ifdef LOG_THREAD_SAFE
+  LogRecord record(this, false);
+#else
+  LogRecord &record = _record;
+#endif
+  beginRecord(record, level);
+#ifdef LOG_BINARY_FORMAT
+  if (length > 0xFFFF)
+  {
+    length = 0xFFFF;
+  }
+  printBinaryHeader(record, level, LogTables<>::hexdumpFormat, true);
+  printBinaryValue(record, length, 2);
+  for (size_t i = 0; i < length; i++)
+  {
+    printBinaryByte(record, flash ? pgm_read_byte(data + i) : data[i]);
+  }
+  printBinaryFooter(record);
+#else
+  printPrefix(record, level, NULL);
+  record.buffer.appendUnsigned(length);
+  record.buffer.append_P(PSTR(" bytes" CR));
+  for (size_t offset = 0; offset < length; offset += LOG_HEXDUMP_WIDTH)
+  {
+#ifdef LOG_ASYNC_BUFFER_SIZE
+    // Queue the lines so far, the rest of the dump continues in a new
+    // record without a level tag. Structured records are closed and the
+    // next row starts a complete record of its own.
+    if (_recordFormat != LOG_RECORD_TEXT)
+    {
+      endMessage(record);
+      printSuffix(record);
+    }
+    endRecord(record);
+    beginRecord(record, level);
+    if (_recordFormat != LOG_RECORD_TEXT)
+    {
+      printPrefix(record, level, NULL);
+    }
+#endif
+    size_t count = length - offset;
+    printHexdumpRow(record, data + offset, offset, count < LOG_HEXDUMP_WIDTH ? count : LOG_HEXDUMP_WIDTH, flash);
+  }
+  if (_recordFormat != LOG_RECORD_TEXT)
+  {
+    endMessage(record);
+  }
+  printSuffix(record);
+#endif
+  endRecord(record);
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printHexdumpRow(LogRecord &record, const uint8_t *data, size_t offset, uint8_t count, bool flash)
+{
+  // "0000  " is appended first, then hex bytes and characters in one block
+  char row[4 * LOG_HEXDUMP_WIDTH + 2 + sizeof(CR) - 1];
+  char *hex = row;
+  char *text = row + 3 * LOG_HEXDUMP_WIDTH + 1;
+  for (uint8_t i = 0; i < LOG_HEXDUMP_WIDTH; i++)
+  {
+    if (i < count)
+    {
+      uint8_t b = flash ? pgm_read_byte(data + i) : data[i];
+      hex[0] = LogBuffer::hexDigit(b >> 4);
+      hex[1] = LogBuffer::hexDigit(b);
+      *text++ = b >= 0x20 && b < 0x7F ? (char)b : '.';
+    }
+    else
+    {
+      hex[0] = ' ';
+      hex[1] = ' ';
+    }
+    hex[2] = ' ';
+    hex += 3;
+  }
+  *hex = ' ';
+  memcpy_P(text, PSTR(CR), sizeof(CR) - 1);
+  text += sizeof(CR) - 1;
+
+  record.buffer.appendHex(offset, 4, '0');
+  record.buffer.append(' ');
+  record.buffer.append(' ');
+  record.buffer.append(row, text - row);
+}
+#endif
+
+#ifdef LOG_ASYNC_BUFFER_SIZE
+template <class Config>
+inline size_t BasicLogging<Config>::drain(size_t maxBytes)
+{
+#ifndef DISABLE_LOGGING
+  return _ring.drain(maxBytes);
+#else
+  return 0;
+#endif
+}
+
+template <class Config>
+inline void BasicLogging<Config>::setOverflowPolicy(uint8_t policy)
+{
+#ifndef DISABLE_LOGGING
+  _ring.setOverflowPolicy(policy);
+#endif
+}
+
+template <class Config>
+inline uint32_t BasicLogging<Config>::getDroppedCount() const
+{
+#ifndef DISABLE_LOGGING
+  return _ring.getDroppedCount();
+#else
+  return 0;
+#endif
+}
+
+#if defined(ESP32)
+template <class Logger>
+inline void logDrainTask(void *arg)
+{
+  Logger *log = static_cast<Logger *>(arg);
+  for (;;)
+  {
+    if (log->drain() == 0)
+    {
+      vTaskDelay(1);
+    }
+  }
+}
+
+template <class Config>
+inline bool BasicLogging<Config>::startDrainTask(UBaseType_t priority, uint32_t stackSize)
+{
+#ifndef DISABLE_LOGGING
+  if (xTaskCreate(logDrainTask<BasicLogging<Config> >, "logDrain", stackSize, this, priority, NULL) != pdPASS)
+  {
+    return false;
+  }
+  _ring.setConsumerActive(true);
+  return true;
+#else
+  return false;
+#endif
+}
+#endif
+#endif
+
+#if defined(LOG_BINARY_FORMAT) && !defined(DISABLE_LOGGING)
+// A binary record is a SLIP frame (RFC 1055):
+//
+//   END | header | format address | millis() | arguments | checksum | END
+//
+// header:   bits 0-2 level, bit 3 format string is in program memory,
+//           bits 4 and 7 the integer size (0 = 4, 1 = 2, 2 = 8 bytes),
+//           bits 5-6 log2 of the pointer size minus one (0 = 2, 1 = 4,
+//           2 = 8 bytes)
+// address:  the format string pointer, little endian; the host decoder
+//           looks the string up in the .elf file
+// millis(): 4 bytes, little endian
+// arguments in format string order: %d %i %x %X %b %B integer sized,
+//           %l %u 4 bytes or 8 if the integer size is, %c %t %T 1 byte, %D %F float (4 bytes),
+//           %I 4 bytes, %s %S %P zero terminated characters
+//           hexdump() records use the format "%H": a 2 byte length and
+//           the raw bytes
+// checksum: XOR of all bytes between the END markers before escaping
+#define LOG_SLIP_END     0xC0
+#define LOG_SLIP_ESC     0xDB
+#define LOG_SLIP_ESC_END 0xDC
+#define LOG_SLIP_ESC_ESC 0xDD
+
+template <class Config>
+inline void BasicLogging<Config>::printBinaryHeader(LogRecord &record, int level, const char *format, bool flash, uint8_t intSize)
+{
+  uint8_t header = level & 0x07;
+  if (flash)
+  {
+    header |= 0x08;
+  }
+  if (intSize == 2)
+  {
+    header |= 0x10;
+  }
+  else if (intSize == 8)
+  {
+    header |= 0x80;
+  }
+  header |= (sizeof(const char *) == 2 ? 0 : sizeof(const char *) == 4 ? 1 : 2) << 5;
+
+  record.buffer.append((char)LOG_SLIP_END);
+  record.checksum = 0;
+  record.intSize = intSize;
+  printBinaryByte(record, header);
+  uintptr_t address = reinterpret_cast<uintptr_t>(format);
+  for (uint8_t i = 0; i < sizeof(const char *); i++)
+  {
+    printBinaryByte(record, address & 0xFF);
+    address >>= 8;
+  }
+  printBinaryValue(record, millis(), 4);
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printBinaryFooter(LogRecord &record)
+{
+  printBinaryByte(record, record.checksum);
+  record.buffer.append((char)LOG_SLIP_END);
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printBinaryArg(LogRecord &record, const char format, long value)
+{
+  if (record.intSize > sizeof(long))
+  {
+    // Sign extend to the 8 bytes of a record with long long arguments
+    printBinaryArg(record, format, (unsigned long long)value);
+  }
+  else
+  {
+    printBinaryArg(record, format, (unsigned long)value);
+  }
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printBinaryArg(LogRecord &record, const char format, unsigned long value)
+{
+  switch (format)
+  {
+    case 'd':
+    case 'i':
+    case 'x':
+    case 'X':
+    case 'b':
+    case 'B':
+      printBinaryValue(record, value, record.intSize);
+      break;
+    case 'l':
+    case 'u':
+      printBinaryValue(record, value, record.intSize > 4 ? record.intSize : 4);
+      break;
+    case 'I':
+    case 'Q':
+      printBinaryValue(record, value, 4);
+      break;
+    case 'c':
+    case 't':
+    case 'T':
+      printBinaryByte(record, value);
+      break;
+    case 'D':
+    case 'F':
+      printBinaryArg(record, format, (double)value);
+      break;
+    case 's':
+    case 'S':
+    case 'P':
+      printBinaryByte(record, 0);
+      break;
+  }
+}
 
-// #include "ArduinoLog.h"
+template <class Config>
+inline void BasicLogging<Config>::printBinaryArg(LogRecord &record, const char format, long long value)
+{
+  switch (format)
+  {
+    case 'd':
+    case 'i':
+    case 'x':
+    case 'X':
+    case 'b':
+    case 'B':
+    case 'l':
+    case 'u':
+      printBinaryArg(record, format, (unsigned long long)value);
+      break;
+    default:
+      printBinaryArg(record, format, (long)value);
+      break;
+  }
+}
 
-void Logging::begin(int level, Print* logOutput, bool showLevel)
+template <class Config>
+inline void BasicLogging<Config>::printBinaryArg(LogRecord &record, const char format, unsigned long long value)
 {
-#ifndef DISABLE_LOGGING
-  setLevel(level);
-  setShowLevel(showLevel);
-  _logOutput = logOutput;
-#endif
+  switch (format)
+  {
+    case 'd':
+    case 'i':
+    case 'x':
+    case 'X':
+    case 'b':
+    case 'B':
+    case 'l':
+    case 'u':
+      // A record with a long long argument has 8 byte integers
+      printBinaryValue(record, (unsigned long)(value & 0xFFFFFFFFUL), 4);
+      printBinaryValue(record, (unsigned long)(value >> 32), record.intSize - 4);
+      break;
+    default:
+      printBinaryArg(record, format, (unsigned long)value);
+      break;
+  }
 }
 
-void Logging::setLevel(int level)
+template <class Config>
+inline void BasicLogging<Config>::printBinaryArg(LogRecord &record, const char format, double value)
 {
-#ifndef DISABLE_LOGGING
-  _level = constrain(level, LOG_LEVEL_SILENT, LOG_LEVEL_VERBOSE);
-#endif
+  if (format == 'D' || format == 'F')
+  {
+    float f = value;
+    uint32_t bits;
+    memcpy(&bits, &f, 4);
+    printBinaryValue(record, bits, 4);
+  }
+  else
+  {
+    printBinaryArg(record, format, (long)value);
+  }
 }
 
-int Logging::getLevel() const
+template <class Config>
+inline void BasicLogging<Config>::printBinaryArg(LogRecord &record, const char format, const char *value)
 {
-#ifndef DISABLE_LOGGING
-  return _level;
-#else
-  return 0;
-#endif
+  if (format == 's' || format == 'S' || format == 'P')
+  {
+    printBinaryString(record, value, format == 'P');
+  }
+  else
+  {
+    printBinaryArg(record, format, (unsigned long)reinterpret_cast<uintptr_t>(value));
+  }
 }
 
-void Logging::setOutput(Print* output)
+template <class Config>
+inline void BasicLogging<Config>::printBinaryArg(LogRecord &record, const char format, const __FlashStringHelper *value)
 {
-#ifndef DISABLE_LOGGING
-  _logOutput = output;
-#endif
+  if (format == 's' || format == 'S' || format == 'P')
+  {
+    printBinaryString(record, reinterpret_cast<const char *>(value), true);
+  }
+  else
+  {
+    printBinaryArg(record, format, (unsigned long)reinterpret_cast<uintptr_t>(value));
+  }
 }
 
-void Logging::setShowLevel(bool showLevel)
+template <class Config>
+inline void BasicLogging<Config>::printBinaryArg(LogRecord &record, const char format, const String &value)
 {
-#ifndef DISABLE_LOGGING
-  _showLevel = showLevel;
-#endif
+  if (format == 's' || format == 'S' || format == 'P')
+  {
+    printBinaryString(record, value.c_str(), false);
+  }
+  else
+  {
+    printBinaryArg(record, format, 0UL);
+  }
 }
 
-bool Logging::getShowLevel() const
+template <class Config>
+inline void BasicLogging<Config>::printBinaryArg(LogRecord &record, const char format, const IPAddress &value)
 {
-#ifndef DISABLE_LOGGING
-  return _showLevel;
-#else
-  return false;
-#endif
+  if (format == 'I')
+  {
+    for (uint8_t i = 0; i < 4; i++)
+    {
+      printBinaryByte(record, value[i]);
+    }
+  }
+  else
+  {
+    printBinaryArg(record, format, 0UL);
+  }
 }
 
-void Logging::setPrefix(printfunction f)
+template <class Config>
+inline void BasicLogging<Config>::printBinaryArg(LogRecord &record, const char format, const Printable &)
 {
-#ifndef DISABLE_LOGGING
-  _prefix = f;
+  // Printable objects render to text and are not encoded in binary records
+  printBinaryArg(record, format, 0UL);
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printBinaryArg(LogRecord &record, const char format, const void *value)
+{
+#ifdef LOG_MAX_SPECIFIERS
+  // The decoder cannot render a custom specifier, and skips it
+  if (findSpecifier(format) != NULL)
+  {
+    return;
+  }
 #endif
+  printBinaryArg(record, format, static_cast<const char *>(value));
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printBinaryByte(LogRecord &record, uint8_t b)
+{
+  record.checksum ^= b;
+  if (b == LOG_SLIP_END)
+  {
+    record.buffer.append((char)LOG_SLIP_ESC);
+    record.buffer.append((char)LOG_SLIP_ESC_END);
+  }
+  else if (b == LOG_SLIP_ESC)
+  {
+    record.buffer.append((char)LOG_SLIP_ESC);
+    record.buffer.append((char)LOG_SLIP_ESC_ESC);
+  }
+  else
+  {
+    record.buffer.append((char)b);
+  }
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printBinaryValue(LogRecord &record, unsigned long value, uint8_t size)
+{
+  for (uint8_t i = 0; i < size; i++)
+  {
+    printBinaryByte(record, value & 0xFF);
+    value >>= 8;
+  }
 }
 
-void Logging::setSuffix(printfunction f)
+template <class Config>
+inline void BasicLogging<Config>::printBinaryString(LogRecord &record, const char *s, bool flash)
 {
+  if (s != NULL)
+  {
+    for (char c = flash ? pgm_read_byte(s++) : *s++; c != 0; c = flash ? pgm_read_byte(s++) : *s++)
+    {
+      printBinaryByte(record, c);
+    }
+  }
+  printBinaryByte(record, 0);
+}
+#endif
+
 #ifndef DISABLE_LOGGING
-  _suffix = f;
+template <class Config>
+inline void BasicLogging<Config>::printTimestamp(LogRecord &record, bool padded)
+{
+#ifdef LOG_THREAD_SAFE
+  if (!this->timestamp().isCached())
+  {
+    this->timestamp().print(record.buffer, padded);
+  }
+  else if (record.fromISR)
+  {
+    this->timestamp().printMillis(record.buffer, padded);
+  }
+  else
+  {
+    // The cached clock text is shared by all tasks
+    _lock.lock();
+    this->timestamp().print(record.buffer, padded);
+    _lock.unlock();
+  }
+#else
+  this->timestamp().print(record.buffer, padded);
 #endif
 }
 
-void Logging::print(const __FlashStringHelper *format, va_list args)
+#ifdef LOG_SCOPE_SIZE
+static_assert(LOG_SCOPE_SIZE >= 8 && LOG_SCOPE_SIZE <= 255, "LOG_SCOPE_SIZE must be between 8 and 255");
+static_assert(LOG_SCOPE_DEPTH >= 1 && LOG_SCOPE_DEPTH <= 16, "LOG_SCOPE_DEPTH must be between 1 and 16");
+
+inline void LogContext::push()
 {
-#ifndef DISABLE_LOGGING
-  PGM_P p = reinterpret_cast<PGM_P>(format);
-  char c = pgm_read_byte(p++);
-  for (; c != 0; c = pgm_read_byte(p++))
+  if (_depth < LOG_SCOPE_DEPTH)
   {
-    if (c == '%')
+    _starts[_depth] = _length;
+    _depth++;
+    if (_length > 0)
     {
-      c = pgm_read_byte(p++);
-      printFormat(c, &args);
+      write(' ');
     }
-    else
+    return;
+  }
+  if (_depth < 255)
+  {
+    _depth++;
+  }
+}
+
+inline void LogContext::pop()
+{
+  if (_depth == 0)
+  {
+    return;
+  }
+  _depth--;
+  if (_depth < LOG_SCOPE_DEPTH)
+  {
+    _length = _starts[_depth];
+  }
+}
+
+inline size_t LogContext::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+inline size_t LogContext::write(const uint8_t *data, size_t size)
+{
+  // Only the innermost scope is written to, and only if it is kept
+  if (_depth == 0 || _depth > LOG_SCOPE_DEPTH)
+  {
+    return size;
+  }
+  size_t room = LOG_SCOPE_SIZE - _length;
+  size_t chunk = size < room ? size : room;
+  memcpy(_text + _length, data, chunk);
+  _length += chunk;
+  return size;
+}
+#endif
+
+template <class Config>
+inline void BasicLogging<Config>::printPrefix(LogRecord &record, int level, const char *tagName)
+{
+  if (_recordFormat != LOG_RECORD_TEXT)
+  {
+    printStructuredPrefix(record, level, tagName);
+    return;
+  }
+
+  printTimestamp(record, true);
+
+  if (this->prefixFunction() != NULL)
+  {
+    this->prefixFunction()(&record.buffer);
+  }
+
+  if (this->showsLevel()) {
+    static const char levels[] PROGMEM = "FEWNTV";
+    size_t position = record.buffer.position();
+    record.tagOffset = position < LOG_NO_TAG ? position : LOG_NO_TAG;
+#if !defined(LOG_ASYNC_BUFFER_SIZE) && defined(LOG_THREAD_SAFE)
+    if (record.published)
     {
-      _logOutput->print(c);
+      _outputs.setTagOffset(record.tagOffset);
     }
+#elif !defined(LOG_ASYNC_BUFFER_SIZE)
+    _outputs.setTagOffset(record.tagOffset);
+#endif
+    record.buffer.append(pgm_read_byte(&levels[level - 1]));
+    record.buffer.append(':');
+    record.buffer.append(' ');
+  }
+
+  if (tagName != NULL)
+  {
+    record.buffer.print(tagName);
+    record.buffer.append(':');
+    record.buffer.append(' ');
+  }
+
+#ifdef LOG_SCOPE_SIZE
+  if (_context.length() > 0)
+  {
+    record.buffer.append(_context.text(), _context.length());
+    record.buffer.append(' ');
   }
 #endif
 }
 
-void Logging::print(const char *format, va_list args) {
-#ifndef DISABLE_LOGGING
-  for (; *format != 0; ++format)
+template <class Config>
+inline void BasicLogging<Config>::printStructuredPrefix(LogRecord &record, int level, const char *tagName)
+{
+  // Fixed width entries, so a level's name is found without a pointer table
+  static const char names[] PROGMEM = "fatal\0\0\0error\0\0\0warning\0notice\0\0trace\0\0\0verbose";
+  bool first = true;
+
+  if (_recordFormat == LOG_RECORD_JSON)
+  {
+    record.buffer.append('{');
+  }
+  if (this->timestamp().getMode() != LOG_TIMESTAMP_NONE)
   {
-    if (*format == '%')
+    // The counters are numbers, the clock modes strings
+    bool quoted = this->timestamp().isCached();
+#ifdef LOG_THREAD_SAFE
+    quoted = quoted && !record.fromISR;
+#endif
+    printKey(record, PSTR("ts"), true, true);
+    if (quoted)
     {
-      ++format;
-      printFormat(*format, &args);
+      record.buffer.append('"');
     }
-    else
+    printTimestamp(record, false);
+    if (quoted)
     {
-      _logOutput->print(*format);
+      record.buffer.append('"');
     }
+    first = false;
   }
-#endif
-}
 
-void Logging::printFormat(const char format, va_list *args) {
-#ifndef DISABLE_LOGGING
-  if (format == '%')
+  printKey(record, PSTR("level"), true, first);
+  if (_recordFormat == LOG_RECORD_JSON)
   {
-    _logOutput->print(format);
+    record.buffer.append('"');
+    record.buffer.append_P(&names[(level - 1) * 8]);
+    record.buffer.append('"');
   }
-  else if (format == 's')
+  else
   {
-    register char *s = (char *)va_arg(*args, int);
-    _logOutput->print(s);
+    record.buffer.append_P(&names[(level - 1) * 8]);
   }
-#if !defined(ESP8266)
-  else if (format == 'S')
+
+  if (tagName != NULL)
   {
-    String s = (String)va_arg(*args, String);
-    _logOutput->print(s);
+    printKey(record, PSTR("tag"), true, false);
+    printQuoted(record, tagName);
   }
-  else if (format == 'I')
+
+#ifdef LOG_SCOPE_SIZE
+  if (_context.length() > 0)
   {
-    char s[16];
-    IPAddress ip = (IPAddress)va_arg(*args, IPAddress );
-    sprintf(s, "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
-    _logOutput->print(s);
+    printKey(record, PSTR("scope"), true, false);
+    record.buffer.append('"');
+    record.buffer.setEscape(true);
+    record.buffer.append(_context.text(), _context.length());
+    record.buffer.setEscape(false);
+    record.buffer.append('"');
   }
 #endif
-  else if (format == 'P')
+
+  printKey(record, PSTR("msg"), true, false);
+  record.buffer.append('"');
+  record.buffer.setEscape(true);
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printKey(LogRecord &record, const char *name, bool flash, bool first)
+{
+  if (_recordFormat == LOG_RECORD_JSON)
   {
-    register __FlashStringHelper *s = (__FlashStringHelper *)va_arg(*args, int);
-    _logOutput->print(s);
+    if (!first)
+    {
+      record.buffer.append(',');
+    }
+    record.buffer.append('"');
   }
-  else if (format == 'd' || format == 'i')
+  else if (!first)
   {
-    _logOutput->print(va_arg(*args, int), DEC);
+    record.buffer.append(' ');
   }
-  else if (format == 'D' || format == 'F')
+  if (flash)
   {
-    _logOutput->print(va_arg(*args, double));
+    record.buffer.append_P(name);
   }
-  else if (format == 'x')
+  else
   {
-    _logOutput->print(va_arg(*args, int), HEX);
+    record.buffer.print(name);
   }
-  else if (format == 'X')
+  if (_recordFormat == LOG_RECORD_JSON)
   {
-    _logOutput->print("0x");
-    _logOutput->print(va_arg(*args, int), HEX);
+    record.buffer.append('"');
+    record.buffer.append(':');
   }
-  else if (format == 'b')
+  else
   {
-    _logOutput->print(va_arg(*args, int), BIN);
+    record.buffer.append('=');
   }
-  else if (format == 'B')
+}
+
+template <class Config>
+inline void BasicLogging<Config>::endMessage(LogRecord &record)
+{
+  record.buffer.setEscape(false);
+  record.buffer.append('"');
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFieldValue(LogRecord &record, bool value)
+{
+  record.buffer.append_P(value ? PSTR("true") : PSTR("false"));
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFieldValue(LogRecord &record, long value)
+{
+  record.buffer.appendSigned(value);
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFieldValue(LogRecord &record, unsigned long value)
+{
+  record.buffer.appendUnsigned(value);
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFieldValue(LogRecord &record, long long value)
+{
+  record.buffer.appendLongLong(value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value, 10, 0, ' ', value < 0);
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFieldValue(LogRecord &record, unsigned long long value)
+{
+  record.buffer.appendLongLong(value, 10);
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFieldValue(LogRecord &record, double value)
+{
+  // NaN and infinity are not valid JSON numbers
+  if (_recordFormat == LOG_RECORD_JSON && !(value - value == 0))
   {
-    _logOutput->print("0b");
-    _logOutput->print(va_arg(*args, int), BIN);
+    record.buffer.append_P(PSTR("null"));
+    return;
   }
-  else if (format == 'l')
+  record.buffer.appendFloat(value, LOG_DEFAULT_PRECISION);
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFieldValue(LogRecord &record, const char *value)
+{
+  printQuoted(record, value);
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFieldValue(LogRecord &record, const __FlashStringHelper *value)
+{
+  printQuoted(record, value);
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFieldValue(LogRecord &record, const String &value)
+{
+  printQuoted(record, value);
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFieldValue(LogRecord &record, const IPAddress &value)
+{
+  printQuoted(record, value);
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFieldValue(LogRecord &record, const Printable &value)
+{
+  printQuoted(record, value);
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFieldValue(LogRecord &record, const void *value)
+{
+  record.buffer.append('"');
+  record.buffer.append('0');
+  record.buffer.append('x');
+  record.buffer.appendHex((unsigned long)reinterpret_cast<uintptr_t>(value));
+  record.buffer.append('"');
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printSuffix(LogRecord &record)
+{
+  if (_recordFormat == LOG_RECORD_JSON)
   {
-    _logOutput->print(va_arg(*args, long), DEC);
+    record.buffer.append_P(PSTR("}" CR));
   }
-  else if (format == 'u')
+  else if (_recordFormat == LOG_RECORD_LOGFMT)
   {
-    _logOutput->print(va_arg(*args, unsigned long), DEC);
+    record.buffer.append_P(PSTR(CR));
   }
-  else if (format == 'c')
+  else if (this->suffixFunction() != NULL)
   {
-    _logOutput->print((char) va_arg(*args, int));
+    this->suffixFunction()(&record.buffer);
   }
-  else if (format == 't')
+}
+
+template <class Config>
+inline char BasicLogging<Config>::printLiteral(LogRecord &record, const char *&format, bool flash, bool output)
+{
+  for (;;)
   {
-    if (va_arg(*args, int) == 1)
+    char c = flash ? pgm_read_byte(format) : *format;
+    if (c == 0)
     {
-      _logOutput->print("T");
+      return 0;
     }
-    else
+    ++format;
+    if (c == '%')
+    {
+      c = flash ? pgm_read_byte(format) : *format;
+      if (c == 0)
+      {
+        return 0;
+      }
+      ++format;
+      if (c != '%')
+      {
+        record.fieldPad = ' ';
+        record.fieldWidth = 0;
+        record.fieldPrecision = LOG_DEFAULT_PRECISION;
+        if (c == '0')
+        {
+          record.fieldPad = '0';
+          c = flash ? pgm_read_byte(format) : *format;
+          if (c != 0)
+          {
+            ++format;
+          }
+        }
+        while (c >= '0' && c <= '9')
+        {
+          record.fieldWidth = record.fieldWidth * 10 + (c - '0');
+          c = flash ? pgm_read_byte(format) : *format;
+          if (c != 0)
+          {
+            ++format;
+          }
+        }
+        if (c == '.')
+        {
+          record.fieldPrecision = 0;
+          c = flash ? pgm_read_byte(format) : *format;
+          if (c != 0)
+          {
+            ++format;
+          }
+          while (c >= '0' && c <= '9')
+          {
+            record.fieldPrecision = record.fieldPrecision * 10 + (c - '0');
+            c = flash ? pgm_read_byte(format) : *format;
+            if (c != 0)
+            {
+              ++format;
+            }
+          }
+        }
+        return c;
+      }
+    }
+    if (output)
     {
-      _logOutput->print("F");
+      record.buffer.append(c);
     }
   }
-  else if (format == 'T')
+}
+
+// The specifier switches compile to jump tables, so the dispatch costs
+// the same for every specifier
+template <class Config>
+inline void BasicLogging<Config>::printFormat(LogRecord &record, const char format, long value)
+{
+  switch (format)
   {
-    if (va_arg(*args, int) == 1)
+    case 'd':
+    case 'i':
+    case 'l':
+      record.buffer.appendSigned(value, record.fieldWidth, record.fieldPad);
+      break;
+    case 'u':
+      record.buffer.appendUnsigned((unsigned long)value, record.fieldWidth, record.fieldPad);
+      break;
+    case 'Q':
     {
-      _logOutput->print(F("true"));
+      unsigned long magnitude = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+      record.buffer.appendFixed(magnitude, LOG_FIXED_POINT_BITS, value < 0, record.fieldPrecision, record.fieldWidth, record.fieldPad);
+      break;
     }
-    else
+    default:
+      printFormat(record, format, (unsigned long)value);
+      break;
+  }
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFormat(LogRecord &record, const char format, unsigned long value)
+{
+  switch (format)
+  {
+    case 'x':
+      record.buffer.appendHex(value, record.fieldWidth, record.fieldPad);
+      break;
+    case 'X':
+      record.buffer.append('0');
+      record.buffer.append('x');
+      record.buffer.appendHex(value, record.fieldWidth, record.fieldPad);
+      break;
+    case 'b':
+      record.buffer.appendBinary(value, record.fieldWidth, record.fieldPad);
+      break;
+    case 'B':
+      record.buffer.append('0');
+      record.buffer.append('b');
+      record.buffer.appendBinary(value, record.fieldWidth, record.fieldPad);
+      break;
+    case 'c':
+      record.buffer.print((char)value);
+      break;
+    case 't':
+      record.buffer.append(value == 1 ? 'T' : 'F');
+      break;
+    case 'T':
+      record.buffer.append_P(value == 1 ? PSTR("true") : PSTR("false"));
+      break;
+    case 'D':
+    case 'F':
+      record.buffer.appendFloat((double)value, record.fieldPrecision, record.fieldWidth, record.fieldPad);
+      break;
+    case 'Q':
+      record.buffer.appendFixed(value, LOG_FIXED_POINT_BITS, false, record.fieldPrecision, record.fieldWidth, record.fieldPad);
+      break;
+    default:
+      record.buffer.appendUnsigned(value, record.fieldWidth, record.fieldPad);
+      break;
+  }
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFormat(LogRecord &record, const char format, long long value)
+{
+  switch (format)
+  {
+    case 'd':
+    case 'i':
+    case 'l':
+      record.buffer.appendLongLong(value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value, 10,
+                                   record.fieldWidth, record.fieldPad, value < 0);
+      break;
+    case 'Q':
+      printFormat(record, format, (long)value);
+      break;
+    default:
+      printFormat(record, format, (unsigned long long)value);
+      break;
+  }
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFormat(LogRecord &record, const char format, unsigned long long value)
+{
+  switch (format)
+  {
+    case 'x':
+      record.buffer.appendLongLong(value, 16, record.fieldWidth, record.fieldPad);
+      break;
+    case 'X':
+      record.buffer.append('0');
+      record.buffer.append('x');
+      record.buffer.appendLongLong(value, 16, record.fieldWidth, record.fieldPad);
+      break;
+    case 'b':
+      record.buffer.appendLongLong(value, 2, record.fieldWidth, record.fieldPad);
+      break;
+    case 'B':
+      record.buffer.append('0');
+      record.buffer.append('b');
+      record.buffer.appendLongLong(value, 2, record.fieldWidth, record.fieldPad);
+      break;
+    case 'c':
+    case 't':
+    case 'T':
+    case 'Q':
+      printFormat(record, format, (unsigned long)value);
+      break;
+    case 'D':
+    case 'F':
+      record.buffer.appendFloat((double)value, record.fieldPrecision, record.fieldWidth, record.fieldPad);
+      break;
+    default:
+      record.buffer.appendLongLong(value, 10, record.fieldWidth, record.fieldPad);
+      break;
+  }
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFormat(LogRecord &record, const char format, double value)
+{
+  switch (format)
+  {
+    case 'D':
+    case 'F':
+      record.buffer.appendFloat(value, record.fieldPrecision, record.fieldWidth, record.fieldPad);
+      break;
+    default:
+      printFormat(record, format, (long)value);
+      break;
+  }
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFormat(LogRecord &record, const char format, const char *value)
+{
+  switch (format)
+  {
+    case 's':
+    case 'S':
+      record.buffer.print(value);
+      break;
+    case 'P':
+      record.buffer.append_P(value);
+      break;
+    default:
+      printFormat(record, format, (unsigned long)reinterpret_cast<uintptr_t>(value));
+      break;
+  }
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFormat(LogRecord &record, const char, const __FlashStringHelper *value)
+{
+  record.buffer.append_P(reinterpret_cast<const char *>(value));
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFormat(LogRecord &record, const char, const String &value)
+{
+  record.buffer.print(value);
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFormat(LogRecord &record, const char, const IPAddress &value)
+{
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    if (i > 0)
     {
-      _logOutput->print(F("false"));
+      record.buffer.append('.');
     }
+    record.buffer.appendUnsigned(value[i]);
+  }
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFormat(LogRecord &record, const char, const Printable &value)
+{
+  record.buffer.print(value);
+}
+
+template <class Config>
+inline void BasicLogging<Config>::printFormat(LogRecord &record, const char format, const void *value)
+{
+#ifdef LOG_MAX_SPECIFIERS
+  formatfunction handler = findSpecifier(format);
+  if (handler != NULL)
+  {
+    handler(&record.buffer, value);
+    return;
   }
 #endif
+  printFormat(record, format, static_cast<const char *>(value));
 }
 
-#ifndef DISABLE_STATIC_LOG
-Logging Log = Logging();
+#ifdef LOG_MAX_SPECIFIERS
+template <class Config>
+inline formatfunction BasicLogging<Config>::findSpecifier(char specifier) const
+{
+  for (uint8_t i = 0; i < _specifierCount; i++)
+  {
+    if (_specifiers[i].specifier == specifier)
+    {
+      return _specifiers[i].handler;
+    }
+  }
+  return NULL;
+}
+#endif
 #endif
+#endif  //  #ifndef LOGGING_H
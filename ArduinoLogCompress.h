@@ -0,0 +1,395 @@
+/*
+    _   ___ ___  _   _ ___ _  _  ___  _    ___   ___
+   /_\ | _ \   \| | | |_ _| \| |/ _ \| |  / _ \ / __|
+  / _ \|   / |) | |_| || || .` | (_) | |_| (_) | (_ |
+  /_/ \_\_|_\___/ \___/|___|_|\_|\___/|____\___/ \___|
+
+  Compressed output for ArduinoLog
+  https://github.com/thijse/Arduino-Log
+
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+
+*/
+
+#ifndef LOGGING_COMPRESS_H
+#define LOGGING_COMPRESS_H
+#include "ArduinoLog.h"
+
+// *************************************************************************
+//  Size of the LZSS window, a power of two between 64 and 4096. A match
+//  can reach this far back into earlier records, so a larger window finds
+//  more of the repeated text but costs RAM and search time. Define
+//  before including.
+// ************************************************************************
+#ifndef LOG_COMPRESS_WINDOW
+#ifdef __AVR__
+#define LOG_COMPRESS_WINDOW 256
+#else
+#define LOG_COMPRESS_WINDOW 1024
+#endif
+#endif
+
+#ifndef LOG_SLIP_END
+#define LOG_SLIP_END     0xC0
+#define LOG_SLIP_ESC     0xDB
+#define LOG_SLIP_ESC_END 0xDC
+#define LOG_SLIP_ESC_ESC 0xDD
+#endif
+
+/**
+   LogCompressor is an output that compresses each record with LZSS and
+   writes it as a SLIP frame to another output. Matches reach back into
+   earlier records, which is where the repeated format text is, and the
+   window is restarted every few records so that a decoder can resync
+   after a lost frame. The frames are decoded on the host with
+   extras/decoder/arduinolog_decompress.py. When the output is a LogSink,
+   e.g. a LogUdpSink, every frame is passed on as one record, so that
+   packets only hold whole frames.
+
+       LogUdpSink<WiFiUDP> sink(udp, IPAddress(192, 168, 1, 10), 5000);
+       LogCompressor compressor(sink);
+       Log.begin(LOG_LEVEL_VERBOSE, &compressor, false);
+
+   A frame is
+
+       END | header | sequence | data | checksum | END
+
+   header:   bits 0-2 level, bit 3 the window was restarted before this
+             record, bits 4-7 log2 of LOG_COMPRESS_WINDOW
+   sequence: frame counter, modulo 256
+   data:     groups of a flag byte and up to eight items, bit 0 first.
+             A clear bit is a literal byte, a set bit a match of two
+             bytes: distance - 1 in the low byte and the upper nibble of
+             the second byte, length - 3 in its lower nibble
+   checksum: XOR of all bytes between the END markers before escaping
+*/
+class LogCompressor : public LogSink
+{
+  public:
+    explicit LogCompressor(Print &output);
+    explicit LogCompressor(LogSink &output);
+
+    /**
+       Turns compression on or off. While off, records are written to
+       the output as they are. Takes effect with the next record the
+       compressor receives, with LOG_ASYNC_BUFFER_SIZE the next one
+       drained.
+
+       \param enabled - true to compress
+       \return void
+    */
+    void setEnabled(bool enabled) { _enabled = enabled; }
+
+    /**
+       Sets after how many records the window is restarted. A decoder
+       that lost a frame skips records until the next restart.
+
+       \param records - 1 to compress every record on its own, 0 to only
+                        restart after setEnabled(true)
+       \return void
+    */
+    void setResetInterval(uint8_t records) { _resetInterval = records; }
+
+    virtual void beginRecord(int level);
+    virtual void endRecord(int level);
+
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *data, size_t size);
+    using Print::write;
+
+  private:
+    static const uint8_t MIN_MATCH = 3;
+    static const uint8_t MAX_MATCH = 18;
+    static const uint16_t MASK = LOG_COMPRESS_WINDOW - 1;
+    static const uint8_t STAGE_SIZE = 32;
+
+    void beginFrame(int level);
+
+    void endFrame();
+
+    void encode();
+
+    uint8_t windowByte(uint16_t distance, uint8_t offset) const;
+
+    void addItem(bool match, uint8_t first, uint8_t second);
+
+    void flushGroup();
+
+    void putEscaped(uint8_t b);
+
+    void putRaw(uint8_t b)
+    {
+      if (_stageLength == STAGE_SIZE)
+      {
+        flushStage();
+      }
+      _stage[_stageLength++] = b;
+    }
+
+    void flushStage();
+
+    Print *_output;
+    LogSink *_sink;
+    uint16_t _head;           // next position in _window
+    uint16_t _filled;         // valid bytes in _window
+    uint8_t _ahead[MAX_MATCH];
+    uint8_t _aheadLength;
+    uint8_t _group[1 + 2 * 8];
+    uint8_t _groupLength;
+    uint8_t _groupItems;
+    uint8_t _checksum;
+    uint8_t _sequence;
+    uint8_t _records;         // records since the window was restarted
+    uint8_t _resetInterval;
+    bool _enabled;
+    bool _compressing;        // the current record is compressed
+    bool _inFrame;
+    uint8_t _stageLength;
+    uint8_t _stage[STAGE_SIZE];   // escaped frame bytes not yet written
+    uint8_t _window[LOG_COMPRESS_WINDOW];
+};
+
+static_assert(LOG_COMPRESS_WINDOW >= 64 && LOG_COMPRESS_WINDOW <= 4096 && (LOG_COMPRESS_WINDOW & (LOG_COMPRESS_WINDOW - 1)) == 0,
+              "LOG_COMPRESS_WINDOW must be a power of two between 64 and 4096");
+
+// ==== IMPLEMENTATION =======================================================
+
+inline LogCompressor::LogCompressor(Print &output)
+  : _output(&output), _sink(NULL), _head(0), _filled(0), _aheadLength(0), _groupLength(0),
+    _groupItems(0), _checksum(0), _sequence(0), _records(0), _resetInterval(16),
+    _enabled(true), _compressing(false), _inFrame(false), _stageLength(0)
+{
+}
+
+inline LogCompressor::LogCompressor(LogSink &output)
+  : LogCompressor(static_cast<Print &>(output))
+{
+  _sink = &output;
+}
+
+inline void LogCompressor::beginRecord(int level)
+{
+  if (_enabled != _compressing)
+  {
+    // Start with a fresh window when compression is turned back on
+    _compressing = _enabled;
+    _records = 0;
+  }
+  if (_sink != NULL)
+  {
+    _sink->beginRecord(level);
+  }
+  if (_compressing)
+  {
+    beginFrame(level);
+  }
+}
+
+inline void LogCompressor::endRecord(int level)
+{
+  if (_inFrame)
+  {
+    endFrame();
+  }
+  if (_sink != NULL)
+  {
+    _sink->endRecord(level);
+  }
+}
+
+inline size_t LogCompressor::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+inline size_t LogCompressor::write(const uint8_t *data, size_t size)
+{
+  if (!_compressing)
+  {
+    return _output->write(data, size);
+  }
+  // Output written outside of a record gets a frame of its own
+  bool single = !_inFrame;
+  if (single)
+  {
+    beginFrame(LOG_LEVEL_SILENT);
+  }
+  for (size_t i = 0; i < size; i++)
+  {
+    _ahead[_aheadLength++] = data[i];
+    if (_aheadLength == MAX_MATCH)
+    {
+      encode();
+    }
+  }
+  if (single)
+  {
+    endFrame();
+  }
+  return size;
+}
+
+inline void LogCompressor::beginFrame(int level)
+{
+  uint8_t header = level & 0x07;
+  if (_records == 0)
+  {
+    _head = 0;
+    _filled = 0;
+    header |= 0x08;
+  }
+  uint8_t bits = 0;
+  while ((1U << bits) < LOG_COMPRESS_WINDOW)
+  {
+    bits++;
+  }
+  header |= bits << 4;
+
+  putRaw(LOG_SLIP_END);
+  _checksum = 0;
+  putEscaped(header);
+  putEscaped(_sequence);
+  _inFrame = true;
+}
+
+inline void LogCompressor::endFrame()
+{
+  while (_aheadLength > 0)
+  {
+    encode();
+  }
+  flushGroup();
+  putEscaped(_checksum);
+  putRaw(LOG_SLIP_END);
+  flushStage();
+  _inFrame = false;
+  _sequence++;
+  _records++;
+  if (_resetInterval > 0 && _records >= _resetInterval)
+  {
+    _records = 0;
+  }
+  else if (_records == 0)
+  {
+    // Wrapped without a reset interval; 0 would restart the window
+    _records = 1;
+  }
+}
+
+inline uint8_t LogCompressor::windowByte(uint16_t distance, uint8_t offset) const
+{
+  // Bytes past the window continue into the lookahead; the decoder
+  // copies byte by byte, so a match may overlap the bytes it produces
+  if (offset < distance)
+  {
+    return _window[(_head - distance + offset) & MASK];
+  }
+  return _ahead[offset - distance];
+}
+
+inline void LogCompressor::encode()
+{
+  uint8_t bestLength = 0;
+  uint16_t bestDistance = 0;
+  for (uint16_t distance = 1; distance <= _filled; distance++)
+  {
+    if (windowByte(distance, 0) != _ahead[0])
+    {
+      continue;
+    }
+    uint8_t length = 1;
+    while (length < _aheadLength && windowByte(distance, length) == _ahead[length])
+    {
+      length++;
+    }
+    if (length > bestLength)
+    {
+      bestLength = length;
+      bestDistance = distance;
+      if (length == _aheadLength)
+      {
+        break;
+      }
+    }
+  }
+
+  uint8_t consumed = 1;
+  if (bestLength >= MIN_MATCH)
+  {
+    uint16_t code = bestDistance - 1;
+    addItem(true, code & 0xFF, ((code >> 8) << 4) | (bestLength - MIN_MATCH));
+    consumed = bestLength;
+  }
+  else
+  {
+    addItem(false, _ahead[0], 0);
+  }
+
+  for (uint8_t i = 0; i < consumed; i++)
+  {
+    _window[_head] = _ahead[i];
+    _head = (_head + 1) & MASK;
+  }
+  _filled = _filled + consumed < LOG_COMPRESS_WINDOW ? _filled + consumed : LOG_COMPRESS_WINDOW;
+  _aheadLength -= consumed;
+  memmove(_ahead, _ahead + consumed, _aheadLength);
+}
+
+inline void LogCompressor::addItem(bool match, uint8_t first, uint8_t second)
+{
+  if (_groupItems == 0)
+  {
+    _group[0] = 0;
+    _groupLength = 1;
+  }
+  _group[_groupLength++] = first;
+  if (match)
+  {
+    _group[0] |= 1 << _groupItems;
+    _group[_groupLength++] = second;
+  }
+  if (++_groupItems == 8)
+  {
+    flushGroup();
+  }
+}
+
+inline void LogCompressor::flushGroup()
+{
+  for (uint8_t i = 0; i < _groupLength; i++)
+  {
+    putEscaped(_group[i]);
+  }
+  _groupLength = 0;
+  _groupItems = 0;
+}
+
+inline void LogCompressor::putEscaped(uint8_t b)
+{
+  _checksum ^= b;
+  if (b == LOG_SLIP_END)
+  {
+    putRaw(LOG_SLIP_ESC);
+    putRaw(LOG_SLIP_ESC_END);
+  }
+  else if (b == LOG_SLIP_ESC)
+  {
+    putRaw(LOG_SLIP_ESC);
+    putRaw(LOG_SLIP_ESC_ESC);
+  }
+  else
+  {
+    putRaw(b);
+  }
+}
+
+inline void LogCompressor::flushStage()
+{
+  // One write per chunk instead of one virtual call per byte
+  if (_stageLength > 0)
+  {
+    _output->write(_stage, _stageLength);
+    _stageLength = 0;
+  }
+}
+#endif
@@ -0,0 +1,587 @@
+/*
+    _   ___ ___  _   _ ___ _  _  ___  _    ___   ___
+   /_\ | _ \   \| | | |_ _| \| |/ _ \| |  / _ \ / __|
+  / _ \|   / |) | |_| || || .` | (_) | |_| (_) | (_ |
+  /_/ \_\_|_\___/ \___/|___|_|\_|\___/|____\___/ \___|
+
+  Command console for ArduinoLog
+  https://github.com/thijse/Arduino-Log
+
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+
+*/
+
+#ifndef LOGGING_CONSOLE_H
+#define LOGGING_CONSOLE_H
+#include "ArduinoLog.h"
+
+// *************************************************************************
+//  Longest command line the console accepts; longer lines are rejected.
+//  Define before including.
+// ************************************************************************
+#ifndef LOG_CONSOLE_LINE
+#define LOG_CONSOLE_LINE 32
+#endif
+
+// *************************************************************************
+//  Number of outputs and tags that can be given a name for the console.
+//  Define before including.
+// ************************************************************************
+#ifndef LOG_CONSOLE_NAMES
+#define LOG_CONSOLE_NAMES 4
+#endif
+
+/**
+   LogConsole reads commands from a Stream, usually the serial port the
+   log is printed to, and changes the logger while the sketch runs. Call
+   update() from loop(); it reads what has arrived without waiting and
+   runs a command once its line is complete.
+
+       LogConsole console(Log, Serial);
+       console.addOutput("sd", &sdSink);
+       console.addTag(TAG_WIFI);
+       ...
+       console.update();            // in loop()
+
+   Commands, one per line, with levels as a number or a name that may be
+   shortened, e.g. "4", "notice" or "n":
+
+       level <level>                 set the global level
+       level <tag> <level>           set a tag, by id or name; "inherit"
+                                     follows the global level again
+       output <name> <level>         set an output, added if not attached;
+                                     "silent" mutes it
+       sample <level> <rate> [random]
+       show                          print the levels
+       help                          list the commands
+
+   Every command is answered with "ok" or an error on the stream.
+
+   LogConsole works with the default Logging; BasicLogConsole<Config>
+   goes with a BasicLogging<Config> of your own.
+*/
+template <class Config>
+class BasicLogConsole
+{
+  public:
+    BasicLogConsole(BasicLogging<Config> &log, Stream &stream);
+
+    /**
+       Names an output so that the output command can change it.
+
+       \param name - the name, compared ignoring case
+       \param output - the output
+       \return false if LOG_CONSOLE_NAMES names are already used
+    */
+    bool addOutput(const char *name, Print *output);
+
+    /**
+       Names a LogSink so that the output command can change it.
+
+       \param name - the name, compared ignoring case
+       \param output - the sink
+       \return false if LOG_CONSOLE_NAMES names are already used
+    */
+    bool addOutput(const char *name, LogSink *output);
+
+#ifdef LOG_MAX_TAGS
+    /**
+       Lets the level command address a tag by its name, and show list
+       it. Tags can always be addressed by id.
+
+       \param tag - the tag; it must have a name and outlive the console
+       \return false if LOG_CONSOLE_NAMES names are already used
+    */
+    bool addTag(const LogTag &tag);
+#endif
+
+    /**
+       Reads the characters that have arrived and runs a completed
+       command. Never waits for input.
+
+       \return void
+    */
+    void update();
+
+  private:
+    // Returned by parseLevel(); -1 is LOG_LEVEL_INHERIT
+    static const int INVALID_LEVEL = -2;
+
+    static const char LEVEL_NAMES[];
+
+    enum Kind
+    {
+      KIND_OUTPUT,
+      KIND_SINK,
+      KIND_TAG
+    };
+
+    struct Name
+    {
+      const char *name;
+      const void *target;
+      uint8_t kind;
+    };
+
+    bool addName(const char *name, const void *target, uint8_t kind);
+
+    void run();
+
+    char *nextWord();
+
+    void runLevel(char *first, char *second);
+
+    void runOutput(char *name, char *levelWord);
+
+    void runSample(char *levelWord, char *rateWord, char *mode);
+
+    void runShow();
+
+    void runHelp();
+
+    const Name *findName(const char *word, uint8_t kind) const;
+
+    static int parseLevel(const char *word, bool inherit);
+
+    static bool parseNumber(const char *word, long &value);
+
+    static bool matches(const char *word, const char *keyword, bool prefix);
+
+    static bool equals(const char *word, const char *name);
+
+    void printLevel(int level);
+
+    void reply(bool ok);
+
+    BasicLogging<Config> &_log;
+    Stream &_stream;
+    Name _names[LOG_CONSOLE_NAMES];
+    uint8_t _nameCount;
+    uint8_t _length;
+    uint8_t _parse;           // next character nextWord() looks at
+    bool _overflow;           // the line is too long and is skipped
+    char _line[LOG_CONSOLE_LINE + 1];
+};
+
+typedef BasicLogConsole<LogConfig> LogConsole;
+
+static_assert(LOG_CONSOLE_LINE >= 16 && LOG_CONSOLE_LINE <= 128, "LOG_CONSOLE_LINE must be between 16 and 128");
+
+// ==== IMPLEMENTATION =======================================================
+
+// Level names at a stride of 8, from LOG_LEVEL_SILENT to LOG_LEVEL_VERBOSE
+template <class Config>
+const char BasicLogConsole<Config>::LEVEL_NAMES[] PROGMEM =
+  "silent\0\0fatal\0\0\0error\0\0\0warning\0notice\0\0trace\0\0\0verbose";
+
+template <class Config>
+inline BasicLogConsole<Config>::BasicLogConsole(BasicLogging<Config> &log, Stream &stream)
+  : _log(log), _stream(stream), _nameCount(0), _length(0), _parse(0), _overflow(false)
+{
+}
+
+template <class Config>
+inline bool BasicLogConsole<Config>::addOutput(const char *name, Print *output)
+{
+  return addName(name, output, KIND_OUTPUT);
+}
+
+template <class Config>
+inline bool BasicLogConsole<Config>::addOutput(const char *name, LogSink *output)
+{
+  return addName(name, output, KIND_SINK);
+}
+
+#ifdef LOG_MAX_TAGS
+template <class Config>
+inline bool BasicLogConsole<Config>::addTag(const LogTag &tag)
+{
+  return tag.name() != NULL && addName(tag.name(), &tag, KIND_TAG);
+}
+#endif
+
+template <class Config>
+inline bool BasicLogConsole<Config>::addName(const char *name, const void *target, uint8_t kind)
+{
+  if (_nameCount == LOG_CONSOLE_NAMES)
+  {
+    return false;
+  }
+  _names[_nameCount].name = name;
+  _names[_nameCount].target = target;
+  _names[_nameCount].kind = kind;
+  _nameCount++;
+  return true;
+}
+
+template <class Config>
+inline void BasicLogConsole<Config>::update()
+{
+  while (_stream.available() > 0)
+  {
+    int c = _stream.read();
+    if (c < 0)
+    {
+      return;
+    }
+    if (c == '\r' || c == '\n')
+    {
+      if (_overflow)
+      {
+        _stream.println(F("error: line too long"));
+      }
+      else if (_length > 0)
+      {
+        _line[_length] = 0;
+        run();
+      }
+      _length = 0;
+      _overflow = false;
+      // One command per call keeps the time spent in loop() short
+      if (c == '\n')
+      {
+        return;
+      }
+    }
+    else if (c == '\b' || c == 0x7F)
+    {
+      if (_length > 0)
+      {
+        _length--;
+      }
+    }
+    else if (_length < LOG_CONSOLE_LINE)
+    {
+      _line[_length++] = c;
+    }
+    else
+    {
+      _overflow = true;
+    }
+  }
+}
+
+template <class Config>
+inline void BasicLogConsole<Config>::run()
+{
+  _parse = 0;
+  char *command = nextWord();
+  if (command == NULL)
+  {
+    return;
+  }
+  char *first = nextWord();
+  char *second = nextWord();
+  char *third = nextWord();
+  if (matches(command, PSTR("level"), false))
+  {
+    runLevel(first, second);
+  }
+  else if (matches(command, PSTR("output"), false))
+  {
+    runOutput(first, second);
+  }
+  else if (matches(command, PSTR("sample"), false))
+  {
+    runSample(first, second, third);
+  }
+  else if (matches(command, PSTR("show"), false))
+  {
+    runShow();
+  }
+  else if (matches(command, PSTR("help"), false) || matches(command, PSTR("?"), false))
+  {
+    runHelp();
+  }
+  else
+  {
+    _stream.println(F("error: unknown command, try help"));
+  }
+}
+
+template <class Config>
+inline char *BasicLogConsole<Config>::nextWord()
+{
+  while (_parse < _length && (_line[_parse] == ' ' || _line[_parse] == '\t'))
+  {
+    _parse++;
+  }
+  if (_parse >= _length)
+  {
+    return NULL;
+  }
+  char *word = &_line[_parse];
+  while (_parse < _length && _line[_parse] != ' ' && _line[_parse] != '\t')
+  {
+    _parse++;
+  }
+  _line[_parse++] = 0;
+  return word;
+}
+
+template <class Config>
+inline void BasicLogConsole<Config>::runLevel(char *first, char *second)
+{
+  if (second == NULL)
+  {
+    int level = first != NULL ? parseLevel(first, false) : INVALID_LEVEL;
+    if (level >= 0)
+    {
+      _log.setLevel(level);
+    }
+    reply(level >= 0);
+    return;
+  }
+#ifdef LOG_MAX_TAGS
+  long id;
+  if (parseNumber(first, id))
+  {
+    if (id < 0 || id >= LOG_MAX_TAGS)
+    {
+      reply(false);
+      return;
+    }
+  }
+  else
+  {
+    const Name *name = findName(first, KIND_TAG);
+    if (name == NULL)
+    {
+      _stream.println(F("error: unknown tag"));
+      return;
+    }
+    id = static_cast<const LogTag *>(name->target)->id();
+  }
+  int level = parseLevel(second, true);
+  if (level != INVALID_LEVEL)
+  {
+    _log.setTagLevel(LogTag(id), level);
+  }
+  reply(level != INVALID_LEVEL);
+#else
+  _stream.println(F("error: no tags, define LOG_MAX_TAGS"));
+#endif
+}
+
+template <class Config>
+inline void BasicLogConsole<Config>::runOutput(char *name, char *levelWord)
+{
+  const Name *output = name != NULL ? findName(name, KIND_OUTPUT) : NULL;
+  if (output == NULL)
+  {
+    output = name != NULL ? findName(name, KIND_SINK) : NULL;
+  }
+  if (output == NULL)
+  {
+    _stream.println(F("error: unknown output"));
+    return;
+  }
+  int level = levelWord != NULL ? parseLevel(levelWord, false) : INVALID_LEVEL;
+  if (level < 0)
+  {
+    reply(false);
+    return;
+  }
+  Print *print = static_cast<Print *>(const_cast<void *>(output->target));
+  bool ok = _log.setOutputLevel(print, level);
+  if (!ok && level > LOG_LEVEL_SILENT)
+  {
+    ok = output->kind == KIND_SINK ? _log.addOutput(static_cast<LogSink *>(print), level)
+                                   : _log.addOutput(print, level);
+  }
+  reply(ok || level == LOG_LEVEL_SILENT);
+}
+
+template <class Config>
+inline void BasicLogConsole<Config>::runSample(char *levelWord, char *rateWord, char *mode)
+{
+#ifdef LOG_SAMPLING
+  int level = levelWord != NULL ? parseLevel(levelWord, false) : INVALID_LEVEL;
+  long rate;
+  bool random = mode != NULL && matches(mode, PSTR("random"), true);
+  if (level <= LOG_LEVEL_SILENT || rateWord == NULL || !parseNumber(rateWord, rate) ||
+      rate < 0 || rate > 0xFFFF || (mode != NULL && !random))
+  {
+    reply(false);
+    return;
+  }
+  _log.setSampleRate(level, rate, random);
+  reply(true);
+#else
+  (void)levelWord;
+  (void)rateWord;
+  (void)mode;
+  _stream.println(F("error: no sampling, define LOG_SAMPLING"));
+#endif
+}
+
+template <class Config>
+inline void BasicLogConsole<Config>::runShow()
+{
+  _stream.print(F("level "));
+  printLevel(_log.getLevel());
+  _stream.println();
+#ifdef LOG_MAX_TAGS
+  for (uint8_t i = 0; i < _nameCount; i++)
+  {
+    if (_names[i].kind == KIND_TAG)
+    {
+      const LogTag *tag = static_cast<const LogTag *>(_names[i].target);
+      _stream.print(F("tag "));
+      _stream.print(tag->name());
+      _stream.print(' ');
+      printLevel(_log.getTagLevel(*tag));
+      _stream.println();
+    }
+  }
+#endif
+  for (uint8_t i = 0; i < _nameCount; i++)
+  {
+    if (_names[i].kind != KIND_TAG)
+    {
+      _stream.print(F("output "));
+      _stream.println(_names[i].name);
+    }
+  }
+}
+
+template <class Config>
+inline void BasicLogConsole<Config>::runHelp()
+{
+  _stream.println(F("level [tag] <level>"));
+  _stream.println(F("output <name> <level>"));
+  _stream.println(F("sample <level> <rate> [random]"));
+  _stream.println(F("show"));
+}
+
+template <class Config>
+inline const typename BasicLogConsole<Config>::Name *BasicLogConsole<Config>::findName(const char *word, uint8_t kind) const
+{
+  for (uint8_t i = 0; i < _nameCount; i++)
+  {
+    if (_names[i].kind == kind && equals(word, _names[i].name))
+    {
+      return &_names[i];
+    }
+  }
+  return NULL;
+}
+
+template <class Config>
+inline int BasicLogConsole<Config>::parseLevel(const char *word, bool inherit)
+{
+  long value;
+  if (parseNumber(word, value))
+  {
+    return value >= LOG_LEVEL_SILENT && value <= LOG_LEVEL_VERBOSE ? value : INVALID_LEVEL;
+  }
+#ifdef LOG_MAX_TAGS
+  if (inherit && matches(word, PSTR("inherit"), true))
+  {
+    return LOG_LEVEL_INHERIT;
+  }
+#else
+  (void)inherit;
+#endif
+  for (uint8_t level = LOG_LEVEL_SILENT; level <= LOG_LEVEL_VERBOSE; level++)
+  {
+    if (matches(word, LEVEL_NAMES + level * 8, true))
+    {
+      return level;
+    }
+  }
+  return INVALID_LEVEL;
+}
+
+template <class Config>
+inline bool BasicLogConsole<Config>::parseNumber(const char *word, long &value)
+{
+  if (word == NULL || *word == 0)
+  {
+    return false;
+  }
+  value = 0;
+  for (; *word != 0; word++)
+  {
+    if (*word < '0' || *word > '9' || value > 100000L)
+    {
+      return false;
+    }
+    value = value * 10 + (*word - '0');
+  }
+  return true;
+}
+
+template <class Config>
+inline bool BasicLogConsole<Config>::matches(const char *word, const char *keyword, bool prefix)
+{
+  // keyword is in program memory and lower case
+  for (;; word++, keyword++)
+  {
+    char k = pgm_read_byte(keyword);
+    char w = *word;
+    if (w >= 'A' && w <= 'Z')
+    {
+      w += 'a' - 'A';
+    }
+    if (w == 0)
+    {
+      return k == 0 || prefix;
+    }
+    if (w != k)
+    {
+      return false;
+    }
+  }
+}
+
+template <class Config>
+inline bool BasicLogConsole<Config>::equals(const char *word, const char *name)
+{
+  for (;; word++, name++)
+  {
+    char w = *word;
+    char n = *name;
+    if (w >= 'A' && w <= 'Z')
+    {
+      w += 'a' - 'A';
+    }
+    if (n >= 'A' && n <= 'Z')
+    {
+      n += 'a' - 'A';
+    }
+    if (w != n)
+    {
+      return false;
+    }
+    if (w == 0)
+    {
+      return true;
+    }
+  }
+}
+
+template <class Config>
+inline void BasicLogConsole<Config>::printLevel(int level)
+{
+#ifdef LOG_MAX_TAGS
+  if (level == LOG_LEVEL_INHERIT)
+  {
+    _stream.print(F("inherit"));
+    return;
+  }
+#endif
+  if (level < LOG_LEVEL_SILENT || level > LOG_LEVEL_VERBOSE)
+  {
+    _stream.print(level);
+    return;
+  }
+  _stream.print(reinterpret_cast<const __FlashStringHelper *>(LEVEL_NAMES + level * 8));
+}
+
+template <class Config>
+inline void BasicLogConsole<Config>::reply(bool ok)
+{
+  _stream.println(ok ? F("ok") : F("error: invalid arguments"));
+}
+#endif
@@ -0,0 +1,288 @@
+/*
+    _   ___ ___  _   _ ___ _  _  ___  _    ___   ___
+   /_\ | _ \   \| | | |_ _| \| |/ _ \| |  / _ \ / __|
+  / _ \|   / |) | |_| || || .` | (_) | |_| (_) | (_ |
+  /_/ \_\_|_\___/ \___/|___|_|\_|\___/|____\___/ \___|
+
+  DMA serial output for ArduinoLog
+  https://github.com/thijse/Arduino-Log
+
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+
+*/
+
+#ifndef LOGGING_DMA_H
+#define LOGGING_DMA_H
+#include "ArduinoLog.h"
+
+// *************************************************************************
+//  Size of each of the two transfer buffers. While the DMA sends one, the
+//  other is filled; a transfer is at most this long. Define before
+//  including.
+// ************************************************************************
+#ifndef LOG_DMA_BUFFER_SIZE
+#define LOG_DMA_BUFFER_SIZE 256
+#endif
+
+/**
+   LogDmaSink is an output that hands the log to a DMA channel in large
+   transfers instead of feeding the UART a byte per interrupt. Writes are
+   copied into one of two buffers; while the DMA sends the other, the CPU
+   is free. When a transfer completes, the DMA interrupt calls
+   transferComplete(), which starts the next transfer right away.
+
+   It works best behind LOG_ASYNC_BUFFER_SIZE, draining no more than the
+   sink can take, so that the records wait in the ring buffer instead of
+   in write():
+
+       Log.drain(dmaSink.availableForWrite());      // in loop()
+
+   A write that finds both buffers full waits for the running transfer.
+   Write from task context only, not from an interrupt handler.
+   transferComplete() must run on the core that writes.
+
+   Derive from it for a DMA controller of your own; LogStm32DmaSink and
+   LogZeroDmaSink cover the STM32 HAL and Adafruit_ZeroDMA on SAMD.
+*/
+class LogDmaSink : public Print
+{
+  public:
+    /**
+       Tells the sink that the running transfer has finished. Call it from
+       the DMA transfer complete interrupt or callback.
+
+       \return void
+    */
+    void transferComplete();
+
+    /**
+       Returns true while a transfer is running.
+    */
+    bool isBusy() const { return _busy; }
+
+    /**
+       Returns the number of transfers that could not be started; their
+       data is lost.
+    */
+    uint32_t getFailedTransfers() const { return _failed; }
+
+    /**
+       Returns the number of bytes that can be written without waiting.
+    */
+    virtual int availableForWrite();
+
+    /**
+       Waits until everything written has been sent.
+
+       \return void
+    */
+    virtual void flush();
+
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *data, size_t size);
+    using Print::write;
+
+  protected:
+    LogDmaSink();
+
+    /**
+       Starts a transfer. It runs with interrupts disabled, or from the
+       DMA interrupt; it must not wait for the transfer.
+
+       \param data - the bytes to send; they stay valid until
+                     transferComplete()
+       \param length - their number, at most LOG_DMA_BUFFER_SIZE
+       \return false if the transfer could not be started
+    */
+    virtual bool startTransfer(const uint8_t *data, size_t length) = 0;
+
+  private:
+    void startNext();
+
+    void kick();
+
+    uint32_t _failed;
+    volatile uint16_t _fill;    // bytes in the buffer being filled
+    volatile uint8_t _active;   // index of the buffer being filled
+    volatile bool _busy;
+    volatile bool _writing;     // write() is copying into the active buffer
+    uint8_t _buffers[2][LOG_DMA_BUFFER_SIZE];
+};
+
+#ifdef HAL_UART_MODULE_ENABLED
+/**
+   LogStm32DmaSink sends the log with HAL_UART_Transmit_DMA() on a UART
+   whose DMA channel is set up by the sketch, e.g. with code generated by
+   STM32CubeMX. The UART must not also be used by HardwareSerial. Forward
+   the transfer complete callback:
+
+       LogStm32DmaSink dmaSink(huart2);
+
+       extern "C" void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+       {
+         if (huart == &huart2) dmaSink.transferComplete();
+       }
+*/
+class LogStm32DmaSink : public LogDmaSink
+{
+  public:
+    explicit LogStm32DmaSink(UART_HandleTypeDef &uart) : _uart(uart) {}
+
+  protected:
+    virtual bool startTransfer(const uint8_t *data, size_t length)
+    {
+      return HAL_UART_Transmit_DMA(&_uart, const_cast<uint8_t *>(data), length) == HAL_OK;
+    }
+
+  private:
+    UART_HandleTypeDef &_uart;
+};
+#endif
+
+/**
+   LogZeroDmaSink sends the log through an Adafruit_ZeroDMA channel on
+   SAMD21/SAMD51. The sketch allocates the channel, sets the trigger of
+   the SERCOM's TX and adds one descriptor that writes to its DATA
+   register; the sink changes the source and count of that descriptor for
+   every transfer.
+
+       Adafruit_ZeroDMA dma;
+       LogZeroDmaSink<Adafruit_ZeroDMA, DmacDescriptor> dmaSink(dma);
+
+       void dmaDone(Adafruit_ZeroDMA *) { dmaSink.transferComplete(); }
+
+       dma.allocate();
+       dma.setTrigger(SERCOM0_DMAC_ID_TX);
+       dma.setAction(DMA_TRIGGER_ACTON_BEAT);
+       DmacDescriptor *d = dma.addDescriptor(NULL, (void *)&SERCOM0->USART.DATA.reg,
+                                             0, DMA_BEAT_SIZE_BYTE, true, false);
+       dma.setCallback(dmaDone);
+       dmaSink.begin(d);
+*/
+template <class DmaType, class DescriptorType>
+class LogZeroDmaSink : public LogDmaSink
+{
+  public:
+    explicit LogZeroDmaSink(DmaType &dma) : _dma(dma), _descriptor(NULL) {}
+
+    /**
+       \param descriptor - the descriptor the transfers use
+       \return void
+    */
+    void begin(DescriptorType *descriptor) { _descriptor = descriptor; }
+
+  protected:
+    virtual bool startTransfer(const uint8_t *data, size_t length)
+    {
+      if (_descriptor == NULL)
+      {
+        return false;
+      }
+      _dma.changeDescriptor(_descriptor, const_cast<uint8_t *>(data), NULL, length);
+      return _dma.startJob() == 0;
+    }
+
+  private:
+    DmaType &_dma;
+    DescriptorType *_descriptor;
+};
+
+static_assert(LOG_DMA_BUFFER_SIZE >= 16 && LOG_DMA_BUFFER_SIZE <= 32768,
+              "LOG_DMA_BUFFER_SIZE must be between 16 and 32768");
+
+// ==== IMPLEMENTATION =======================================================
+
+inline LogDmaSink::LogDmaSink()
+  : _failed(0), _fill(0), _active(0), _busy(false), _writing(false)
+{
+}
+
+inline void LogDmaSink::transferComplete()
+{
+  _busy = false;
+  // Chain the next transfer, unless write() is filling that buffer; it
+  // starts the transfer itself when it is done
+  if (!_writing)
+  {
+    startNext();
+  }
+}
+
+inline void LogDmaSink::startNext()
+{
+  if (_busy || _fill == 0)
+  {
+    return;
+  }
+  uint8_t buffer = _active;
+  uint16_t length = _fill;
+  _active = buffer ^ 1;
+  _fill = 0;
+  _busy = true;
+  if (!startTransfer(_buffers[buffer], length))
+  {
+    _busy = false;
+    _failed++;
+  }
+}
+
+inline void LogDmaSink::kick()
+{
+  noInterrupts();
+  startNext();
+  interrupts();
+}
+
+inline int LogDmaSink::availableForWrite()
+{
+  return LOG_DMA_BUFFER_SIZE - _fill;
+}
+
+inline void LogDmaSink::flush()
+{
+  while (_busy || _fill > 0)
+  {
+    if (!_busy)
+    {
+      kick();
+    }
+  }
+}
+
+inline size_t LogDmaSink::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+inline size_t LogDmaSink::write(const uint8_t *data, size_t size)
+{
+  size_t written = size;
+  while (size > 0)
+  {
+    // Both buffers are in use: wait for the running transfer
+    while (_fill == LOG_DMA_BUFFER_SIZE)
+    {
+      if (!_busy)
+      {
+        kick();
+      }
+    }
+    _writing = true;
+    LOG_MEMORY_BARRIER();
+    uint16_t fill = _fill;
+    size_t chunk = LOG_DMA_BUFFER_SIZE - fill;
+    if (chunk > size)
+    {
+      chunk = size;
+    }
+    memcpy(_buffers[_active] + fill, data, chunk);
+    _fill = fill + chunk;
+    LOG_MEMORY_BARRIER();
+    _writing = false;
+    data += chunk;
+    size -= chunk;
+    kick();
+  }
+  return written;
+}
+#endif
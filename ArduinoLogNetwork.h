@@ -0,0 +1,352 @@
+/*
+    _   ___ ___  _   _ ___ _  _  ___  _    ___   ___
+   /_\ | _ \   \| | | |_ _| \| |/ _ \| |  / _ \ / __|
+  / _ \|   / |) | |_| || || .` | (_) | |_| (_) | (_ |
+  /_/ \_\_|_\___/ \___/|___|_|\_|\___/|____\___/ \___|
+
+  Network output for ArduinoLog
+  https://github.com/thijse/Arduino-Log
+
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+
+*/
+
+#ifndef LOGGING_NETWORK_H
+#define LOGGING_NETWORK_H
+#include "ArduinoLog.h"
+
+// *************************************************************************
+//  Size of the packet buffer. Records are collected in it and sent as one
+//  datagram or TCP write. 1460 fits an Ethernet frame; the W5100 and the
+//  RAM of an AVR call for less. Define before including.
+// ************************************************************************
+#ifndef LOG_PACKET_SIZE
+#ifdef __AVR__
+#define LOG_PACKET_SIZE 256
+#else
+#define LOG_PACKET_SIZE 1460
+#endif
+#endif
+
+#define LOG_SYSLOG_USER   1
+#define LOG_SYSLOG_LOCAL0 16
+
+/**
+   LogPacketSink collects records in one preallocated packet buffer and
+   sends them when the buffer is full, after a record at or above the
+   flush level, on flush(), or from update() when the oldest record is
+   older than the flush interval. Only whole records are sent, unless a
+   single record is larger than the buffer. Derive from it to send over
+   another transport; LogUdpSink and LogTcpSink cover Arduino networking.
+
+   With setSyslog() every record becomes an RFC 5424 syslog message. Over
+   UDP each message is sent as its own datagram (RFC 5426) and a record
+   too long for the buffer is truncated; over TCP messages are framed by
+   a newline (RFC 6587) and coalesced like plain output.
+*/
+class LogPacketSink : public LogSink
+{
+  public:
+    /**
+       Sends records as syslog messages.
+
+       \param hostname - HOSTNAME field without spaces, NULL for "-"
+       \param appName - APP-NAME field without spaces, NULL for "-"
+       \param facility - syslog facility, e.g. LOG_SYSLOG_LOCAL0
+       \return void
+    */
+    void setSyslog(const char *hostname, const char *appName, uint8_t facility = LOG_SYSLOG_LOCAL0);
+
+    /**
+       Sets the level at and above which a record is sent at once.
+
+       \param level - LOG_LEVEL_SILENT to only send on size or time
+       \return void
+    */
+    void setFlushLevel(int level) { _flushLevel = level; }
+
+    /**
+       Sets how long records may stay in the buffer before update() sends
+       them.
+
+       \param interval - milliseconds, 0 to only send on size or level
+       \return void
+    */
+    void setFlushInterval(unsigned long interval) { _interval = interval; }
+
+    /**
+       Sends the buffered records if the flush interval has passed. Call
+       it from loop().
+
+       \return void
+    */
+    void update();
+
+    /**
+       Sends the buffered records now.
+
+       \return void
+    */
+    virtual void flush();
+
+    /**
+       Returns the number of packets the transport failed to send.
+    */
+    uint32_t getFailedPackets() const { return _failed; }
+
+    virtual void beginRecord(int level);
+    virtual void endRecord(int level);
+
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *data, size_t size);
+    using Print::write;
+
+  protected:
+    /**
+       \param datagram - true if each packet is sent as one datagram
+    */
+    explicit LogPacketSink(bool datagram);
+
+    /**
+       Sends one packet.
+
+       \param data - the packet
+       \param length - its length, at most LOG_PACKET_SIZE
+       \return false if it could not be sent
+    */
+    virtual bool sendPacket(const uint8_t *data, size_t length) = 0;
+
+  private:
+    void sendComplete();
+
+    void makeRoom();
+
+    bool onePerPacket() const { return _syslog && _datagram; }
+
+    const char *_hostname;
+    const char *_appName;
+    uint32_t _failed;
+    unsigned long _interval;
+    unsigned long _pendingSince;
+    size_t _length;
+    size_t _recordStart;     // end of the last complete record
+    int8_t _flushLevel;
+    uint8_t _facility;
+    bool _datagram;
+    bool _syslog;
+    bool _inRecord;
+    bool _truncated;
+    uint8_t _packet[LOG_PACKET_SIZE];
+};
+
+/**
+   LogUdpSink sends the log as UDP datagrams, e.g. to a syslog server.
+
+       WiFiUDP udp;
+       LogUdpSink<WiFiUDP> sink(udp, IPAddress(192, 168, 1, 10), 514);
+       sink.setSyslog("node1", "sensor");
+       Log.addOutput(&sink, LOG_LEVEL_NOTICE);
+       ...
+       sink.update();             // in loop()
+*/
+template <class UdpType>
+class LogUdpSink : public LogPacketSink
+{
+  public:
+    LogUdpSink(UdpType &udp, IPAddress address, uint16_t port)
+      : LogPacketSink(true), _udp(udp), _address(address), _port(port) {}
+
+  protected:
+    virtual bool sendPacket(const uint8_t *data, size_t length)
+    {
+      if (!_udp.beginPacket(_address, _port))
+      {
+        return false;
+      }
+      size_t written = _udp.write(data, length);
+      return _udp.endPacket() && written == length;
+    }
+
+  private:
+    UdpType &_udp;
+    IPAddress _address;
+    uint16_t _port;
+};
+
+/**
+   LogTcpSink sends the log over a connected TCP client. Connecting and
+   reconnecting is left to the sketch; while the client is not connected
+   packets count as failed.
+
+       EthernetClient client;
+       LogTcpSink<EthernetClient> sink(client);
+*/
+template <class ClientType>
+class LogTcpSink : public LogPacketSink
+{
+  public:
+    explicit LogTcpSink(ClientType &client) : LogPacketSink(false), _client(client) {}
+
+  protected:
+    virtual bool sendPacket(const uint8_t *data, size_t length)
+    {
+      return _client.connected() && _client.write(data, length) == length;
+    }
+
+  private:
+    ClientType &_client;
+};
+
+static_assert(LOG_PACKET_SIZE >= 64, "LOG_PACKET_SIZE must be at least 64");
+
+// ==== IMPLEMENTATION =======================================================
+
+inline LogPacketSink::LogPacketSink(bool datagram)
+  : _hostname(NULL), _appName(NULL), _failed(0), _interval(1000), _pendingSince(0),
+    _length(0), _recordStart(0), _flushLevel(LOG_LEVEL_ERROR), _facility(LOG_SYSLOG_LOCAL0),
+    _datagram(datagram), _syslog(false), _inRecord(false), _truncated(false)
+{
+}
+
+inline void LogPacketSink::setSyslog(const char *hostname, const char *appName, uint8_t facility)
+{
+  _hostname = hostname;
+  _appName = appName;
+  _facility = facility;
+  _syslog = true;
+}
+
+inline void LogPacketSink::beginRecord(int level)
+{
+  _inRecord = true;
+  _truncated = false;
+  if (!_syslog)
+  {
+    return;
+  }
+  // Syslog severities 2 (critical) to 7 (debug) follow the log levels;
+  // there is no wall clock, so TIMESTAMP, PROCID, MSGID and SD are empty
+  print('<');
+  print(_facility * 8 + level + 1);
+  print(F(">1 - "));
+  print(_hostname != NULL ? _hostname : "-");
+  print(' ');
+  print(_appName != NULL ? _appName : "-");
+  print(F(" - - - "));
+}
+
+inline void LogPacketSink::endRecord(int level)
+{
+  if (onePerPacket())
+  {
+    // The datagram delimits the message, a trailing newline would be
+    // part of it
+    while (_length > 0 && (_packet[_length - 1] == '\n' || _packet[_length - 1] == '\r'))
+    {
+      _length--;
+    }
+    _recordStart = _length;
+    _inRecord = false;
+    sendComplete();
+    return;
+  }
+  if (_syslog && !_truncated && (_length == _recordStart || _packet[_length - 1] != '\n'))
+  {
+    write('\n');
+  }
+  _inRecord = false;
+  if (_recordStart == 0)
+  {
+    _pendingSince = millis();
+  }
+  _recordStart = _length;
+  if (level <= _flushLevel)
+  {
+    sendComplete();
+  }
+}
+
+inline void LogPacketSink::update()
+{
+  if (_recordStart > 0 && _interval > 0 && millis() - _pendingSince >= _interval)
+  {
+    sendComplete();
+  }
+}
+
+inline void LogPacketSink::flush()
+{
+  sendComplete();
+}
+
+inline size_t LogPacketSink::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+inline size_t LogPacketSink::write(const uint8_t *data, size_t size)
+{
+  size_t written = size;
+  while (size > 0)
+  {
+    if (_length == LOG_PACKET_SIZE)
+    {
+      makeRoom();
+      if (_truncated)
+      {
+        break;
+      }
+    }
+    size_t chunk = LOG_PACKET_SIZE - _length;
+    if (chunk > size)
+    {
+      chunk = size;
+    }
+    memcpy(_packet + _length, data, chunk);
+    _length += chunk;
+    data += chunk;
+    size -= chunk;
+  }
+  if (!_inRecord)
+  {
+    // Output written outside of a record counts as a complete record
+    if (_recordStart == 0 && _length > 0)
+    {
+      _pendingSince = millis();
+    }
+    _recordStart = _length;
+  }
+  return written;
+}
+
+inline void LogPacketSink::makeRoom()
+{
+  if (_recordStart == 0)
+  {
+    // The record alone fills the buffer
+    if (onePerPacket())
+    {
+      _truncated = true;
+      return;
+    }
+    _recordStart = _length;
+  }
+  sendComplete();
+}
+
+inline void LogPacketSink::sendComplete()
+{
+  if (_recordStart == 0)
+  {
+    return;
+  }
+  if (!sendPacket(_packet, _recordStart))
+  {
+    _failed++;
+  }
+  // Move the record in progress to the front
+  _length -= _recordStart;
+  memmove(_packet, _packet + _recordStart, _length);
+  _recordStart = 0;
+}
+#endif
@@ -0,0 +1,422 @@
+/*
+    _   ___ ___  _   _ ___ _  _  ___  _    ___   ___
+   /_\ | _ \   \| | | |_ _| \| |/ _ \| |  / _ \ / __|
+  / _ \|   / |) | |_| || || .` | (_) | |_| (_) | (_ |
+  /_/ \_\_|_\___/ \___/|___|_|\_|\___/|____\___/ \___|
+
+  Persistent log storage for ArduinoLog
+  https://github.com/thijse/Arduino-Log
+
+  Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+
+*/
+
+#ifndef LOGGING_STORAGE_H
+#define LOGGING_STORAGE_H
+#include <inttypes.h>
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+// *************************************************************************
+//  Size of the pages LogStorage writes, including an 8 byte page header.
+//  Use the program page size of the flash chip (256 for most SPI NOR
+//  flash) or the block size of the card (512). Define before including.
+// ************************************************************************
+#ifndef LOG_STORAGE_PAGE_SIZE
+#define LOG_STORAGE_PAGE_SIZE 256
+#endif
+
+/**
+   LogStorageDevice is the medium LogStorage writes to. Implement it for a
+   flash chip or use LogFileDevice for a file. Addresses are byte offsets;
+   LogStorage only programs whole pages at page aligned addresses, and
+   erases a sector before it programs the first page of it.
+*/
+class LogStorageDevice
+{
+  public:
+    virtual ~LogStorageDevice() {}
+
+    /**
+       Reads bytes. Bytes that were never written read as 0xFF.
+
+       \param address - offset of the first byte
+       \param data - destination
+       \param length - number of bytes
+       \return false on a device error
+    */
+    virtual bool read(uint32_t address, uint8_t *data, size_t length) = 0;
+
+    /**
+       Programs one page.
+
+       \param address - page aligned offset
+       \param data - the page
+       \param length - LOG_STORAGE_PAGE_SIZE
+       \return false on a device error
+    */
+    virtual bool program(uint32_t address, const uint8_t *data, size_t length) = 0;
+
+    /**
+       Erases one sector. Afterwards its pages must no longer read as
+       stored pages; a flash chip reads them as 0xFF.
+
+       \param address - sector aligned offset
+       \param length - the sector size
+       \return false on a device error
+    */
+    virtual bool erase(uint32_t address, uint32_t length) = 0;
+};
+
+/**
+   LogFileDevice stores the log region in a file opened for reading and
+   writing, e.g. on an SD card or LittleFS. A file needs no erase before
+   a page is rewritten; erase() only blanks the page headers, so a sector
+   of several pages, e.g. 4096 bytes, keeps that overhead small.
+
+       File file = SD.open("log.bin", O_RDWR | O_CREAT);
+       LogFileDevice<File> device(file);
+*/
+template <class FileType>
+class LogFileDevice : public LogStorageDevice
+{
+  public:
+    explicit LogFileDevice(FileType &file) : _file(file) {}
+
+    virtual bool read(uint32_t address, uint8_t *data, size_t length)
+    {
+      // Past the end of the file reads as erased
+      int count = _file.seek(address) ? _file.read(data, length) : 0;
+      if (count < 0)
+      {
+        count = 0;
+      }
+      memset(data + count, 0xFF, length - count);
+      return true;
+    }
+
+    virtual bool program(uint32_t address, const uint8_t *data, size_t length)
+    {
+      if (!_file.seek(address) || _file.write(data, length) != length)
+      {
+        return false;
+      }
+      _file.flush();
+      return true;
+    }
+
+    virtual bool erase(uint32_t address, uint32_t length)
+    {
+      static const uint8_t blank[2] = { 0xFF, 0xFF };
+      for (uint32_t offset = 0; offset < length; offset += LOG_STORAGE_PAGE_SIZE)
+      {
+        // Pages past the end of the file are blank already
+        if (!_file.seek(address + offset))
+        {
+          break;
+        }
+        if (_file.write(blank, sizeof(blank)) != sizeof(blank))
+        {
+          return false;
+        }
+      }
+      _file.flush();
+      return true;
+    }
+
+  private:
+    FileType &_file;
+};
+
+/**
+   LogStorage is an output that keeps the log in a circular region of a
+   flash chip or file, where it survives a reset. Output is collected in
+   a page buffer and written one whole page at a time, when the page is
+   full, on flush(), or from update() when the oldest buffered byte is
+   older than the flush interval. Each page starts with a small header
+   holding a sequence number, which begin() scans to continue after the
+   newest page. When the region is full, the oldest sector is erased.
+
+       LogStorage storage;
+       storage.begin(&device, 0, 64 * 4096UL, 4096);
+       Log.addOutput(&storage, LOG_LEVEL_ERROR, true);
+       ...
+       storage.update();          // in loop()
+       storage.dump(Serial);      // print the stored log, oldest first
+*/
+class LogStorage : public Print
+{
+  public:
+    LogStorage();
+
+    /**
+       Selects the region and finds the newest stored page.
+
+       \param device - the medium
+       \param start - offset of the region, sector aligned
+       \param size - size of the region, at least two sectors
+       \param sectorSize - erase unit, a multiple of LOG_STORAGE_PAGE_SIZE
+       \return false if the geometry is invalid or the device fails
+    */
+    bool begin(LogStorageDevice *device, uint32_t start, uint32_t size, uint32_t sectorSize);
+
+    /**
+       Sets how long output may stay in the page buffer before update()
+       writes it out as a partly filled page.
+
+       \param interval - milliseconds, 0 to write only full pages
+       \return void
+    */
+    void setFlushInterval(unsigned long interval) { _interval = interval; }
+
+    /**
+       Writes the page buffer if the flush interval has passed. Call it
+       from loop().
+
+       \return void
+    */
+    void update();
+
+    /**
+       Writes the page buffer now, as a partly filled page.
+
+       \return void
+    */
+    virtual void flush();
+
+    /**
+       Prints the stored log, oldest page first. The page buffer is
+       written out first.
+
+       \param output - where to print it
+       \return the number of bytes printed
+    */
+    size_t dump(Print &output);
+
+    /**
+       Erases the whole region.
+
+       \return false on a device error
+    */
+    bool clear();
+
+    /**
+       Returns the number of pages that could not be written.
+    */
+    uint32_t getFailedPages() const { return _failed; }
+
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *data, size_t size);
+    using Print::write;
+
+  private:
+    struct Header
+    {
+      uint16_t magic;
+      uint16_t length;     // bytes of log data in the page
+      uint32_t sequence;
+    };
+
+    static const uint16_t MAGIC = 0x4C47;
+    static const size_t CAPACITY = LOG_STORAGE_PAGE_SIZE - sizeof(Header);
+
+    uint32_t address(uint32_t page) const { return _start + page * (uint32_t)LOG_STORAGE_PAGE_SIZE; }
+
+    bool readPage(uint32_t page, Header &header, bool withData);
+
+    void programPage();
+
+    LogStorageDevice *_device;
+    uint32_t _start;
+    uint32_t _pages;
+    uint32_t _pagesPerSector;
+    uint32_t _page;          // next page to program
+    uint32_t _sequence;      // sequence number of that page
+    uint32_t _failed;
+    unsigned long _interval;
+    unsigned long _pendingSince;
+    size_t _length;
+    uint8_t _buffer[LOG_STORAGE_PAGE_SIZE];
+};
+
+static_assert(LOG_STORAGE_PAGE_SIZE >= 16 && LOG_STORAGE_PAGE_SIZE <= 4096, "LOG_STORAGE_PAGE_SIZE must be between 16 and 4096");
+
+// ==== IMPLEMENTATION =======================================================
+
+inline LogStorage::LogStorage()
+  : _device(NULL), _start(0), _pages(0), _pagesPerSector(1), _page(0),
+    _sequence(0), _failed(0), _interval(0), _pendingSince(0), _length(0)
+{
+}
+
+inline bool LogStorage::begin(LogStorageDevice *device, uint32_t start, uint32_t size, uint32_t sectorSize)
+{
+  _device = NULL;
+  _length = 0;
+  if (device == NULL || sectorSize == 0 || sectorSize % LOG_STORAGE_PAGE_SIZE != 0 ||
+      start % sectorSize != 0 || size % sectorSize != 0 || size / sectorSize < 2)
+  {
+    return false;
+  }
+  _device = device;
+  _start = start;
+  _pages = size / LOG_STORAGE_PAGE_SIZE;
+  _pagesPerSector = sectorSize / LOG_STORAGE_PAGE_SIZE;
+  _page = 0;
+  _sequence = 0;
+
+  bool found = false;
+  uint32_t newest = 0;
+  for (uint32_t page = 0; page < _pages; page++)
+  {
+    Header header;
+    if (readPage(page, header, false) && (!found || (int32_t)(header.sequence - newest) > 0))
+    {
+      found = true;
+      newest = header.sequence;
+      _page = page;
+    }
+  }
+  if (!found)
+  {
+    return true;
+  }
+
+  _page = (_page + 1) % _pages;
+  _sequence = newest + 1;
+  // A page can only be programmed when erased. If an interrupted write
+  // left the next page dirty, continue at the next sector.
+  Header next;
+  if (_page % _pagesPerSector != 0 && _device->read(address(_page), reinterpret_cast<uint8_t *>(&next), sizeof(next)) &&
+      next.magic != 0xFFFF)
+  {
+    _page = (_page / _pagesPerSector + 1) * _pagesPerSector % _pages;
+  }
+  return true;
+}
+
+inline void LogStorage::update()
+{
+  if (_length > 0 && _interval > 0 && millis() - _pendingSince >= _interval)
+  {
+    programPage();
+  }
+}
+
+inline void LogStorage::flush()
+{
+  programPage();
+}
+
+inline size_t LogStorage::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+inline size_t LogStorage::write(const uint8_t *data, size_t size)
+{
+  if (_device == NULL)
+  {
+    return 0;
+  }
+  size_t written = size;
+  while (size > 0)
+  {
+    if (_length == 0)
+    {
+      _pendingSince = millis();
+    }
+    size_t chunk = CAPACITY - _length;
+    if (chunk > size)
+    {
+      chunk = size;
+    }
+    memcpy(_buffer + sizeof(Header) + _length, data, chunk);
+    _length += chunk;
+    data += chunk;
+    size -= chunk;
+    if (_length == CAPACITY)
+    {
+      programPage();
+    }
+  }
+  return written;
+}
+
+inline void LogStorage::programPage()
+{
+  if (_device == NULL || _length == 0)
+  {
+    return;
+  }
+  bool ok = true;
+  if (_page % _pagesPerSector == 0)
+  {
+    ok = _device->erase(address(_page), _pagesPerSector * (uint32_t)LOG_STORAGE_PAGE_SIZE);
+  }
+  Header header = { MAGIC, (uint16_t)_length, _sequence };
+  memcpy(_buffer, &header, sizeof(header));
+  // The rest of the page keeps the erased value
+  memset(_buffer + sizeof(Header) + _length, 0xFF, CAPACITY - _length);
+  if (!ok || !_device->program(address(_page), _buffer, LOG_STORAGE_PAGE_SIZE))
+  {
+    _failed++;
+  }
+  _page = (_page + 1) % _pages;
+  _sequence++;
+  _length = 0;
+}
+
+inline bool LogStorage::readPage(uint32_t page, Header &header, bool withData)
+{
+  uint8_t *target = withData ? _buffer : reinterpret_cast<uint8_t *>(&header);
+  if (!_device->read(address(page), target, withData ? LOG_STORAGE_PAGE_SIZE : sizeof(header)))
+  {
+    return false;
+  }
+  if (withData)
+  {
+    memcpy(&header, _buffer, sizeof(header));
+  }
+  return header.magic == MAGIC && header.length > 0 && header.length <= CAPACITY;
+}
+
+inline size_t LogStorage::dump(Print &output)
+{
+  if (_device == NULL)
+  {
+    return 0;
+  }
+  programPage();
+  // Starting at the next page to be written gives the oldest page first
+  size_t total = 0;
+  for (uint32_t i = 0; i < _pages; i++)
+  {
+    Header header;
+    if (readPage((_page + i) % _pages, header, true))
+    {
+      total += output.write(_buffer + sizeof(Header), header.length);
+    }
+  }
+  return total;
+}
+
+inline bool LogStorage::clear()
+{
+  if (_device == NULL)
+  {
+    return false;
+  }
+  _length = 0;
+  _page = 0;
+  bool ok = true;
+  for (uint32_t page = 0; page < _pages; page += _pagesPerSector)
+  {
+    ok = _device->erase(address(page), _pagesPerSector * (uint32_t)LOG_STORAGE_PAGE_SIZE) && ok;
+  }
+  return ok;
+}
+#endif
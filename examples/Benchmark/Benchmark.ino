@@ -0,0 +1,110 @@
+#include <ArduinoLog.h>
+
+/*!
+* This sketch measures the cost of the ArduinoLog formatting engine on the
+* target. Every benchmark logs to a sink that only counts the calls and
+* bytes it receives, so the serial port does not distort the timing.
+*
+* Results are printed as CSV, one line per benchmark:
+*
+*   benchmark,iterations,ns_per_record,writes_per_record,bytes_per_record
+*
+* Capture them from two releases and compare to spot regressions.
+*/
+
+#define ITERATIONS 1000
+
+// Print implementation that discards its input, counting calls and bytes
+class CountingPrint : public Print {
+  public:
+    uint32_t writes;
+    uint32_t bytes;
+
+    CountingPrint() : writes(0), bytes(0) {}
+
+    size_t write(uint8_t) {
+        writes++;
+        bytes++;
+        return 1;
+    }
+
+    size_t write(const uint8_t *, size_t size) {
+        writes++;
+        bytes += size;
+        return size;
+    }
+};
+
+CountingPrint sink;
+Logging       benchLog;
+
+const char    flashText[] PROGMEM = "flash string";
+String        stringValue         = "String value";
+volatile int  intValue            = 12345;
+volatile long longValue           = 123456789L;
+volatile float floatValue         = 3.14159;
+
+void benchIntegers()    { benchLog.notice("int %d %d long %l" CR, intValue, -intValue, longValue); }
+void benchHex()         { benchLog.notice("hex %x %X" CR, intValue, longValue); }
+void benchBinary()      { benchLog.notice("bin %b %B" CR, intValue, intValue); }
+void benchFloat()       { benchLog.notice("float %F" CR, floatValue); }
+void benchString()      { benchLog.notice("String %S" CR, stringValue); }
+void benchFlashFormat() { benchLog.notice(F("flash format %d" CR), intValue); }
+void benchFlashString() { benchLog.notice("flash arg %P" CR, flashText); }
+void benchFiltered()    { benchLog.verbose("filtered %d %x" CR, intValue, intValue); }
+void benchPrefixed()    { benchLog.notice("prefixed %d" CR, intValue); }
+
+void printPrefix(Print* _logOutput) {
+  _logOutput->print(millis());
+  _logOutput->print(' ');
+}
+
+void printSuffix(Print* _logOutput) {
+  _logOutput->print('\n');
+}
+
+void runBenchmark(const __FlashStringHelper *name, void (*body)()) {
+    sink.writes = 0;
+    sink.bytes  = 0;
+    unsigned long start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        body();
+    }
+    unsigned long elapsed = micros() - start;
+
+    Serial.print(name);
+    Serial.print(',');
+    Serial.print(ITERATIONS);
+    Serial.print(',');
+    Serial.print((elapsed * 1000UL) / ITERATIONS);
+    Serial.print(',');
+    Serial.print((float)sink.writes / ITERATIONS);
+    Serial.print(',');
+    Serial.println((float)sink.bytes / ITERATIONS);
+}
+
+void setup() {
+    Serial.begin(115200);
+    while(!Serial && !Serial.available()){}
+
+    benchLog.begin(LOG_LEVEL_NOTICE, &sink);
+
+    Serial.println(F("benchmark,iterations,ns_per_record,writes_per_record,bytes_per_record"));
+    runBenchmark(F("integers"),     benchIntegers);
+    runBenchmark(F("hex"),          benchHex);
+    runBenchmark(F("binary"),       benchBinary);
+    runBenchmark(F("float"),        benchFloat);
+    runBenchmark(F("string"),       benchString);
+    runBenchmark(F("flash_format"), benchFlashFormat);
+    runBenchmark(F("flash_string"), benchFlashString);
+    runBenchmark(F("filtered"),     benchFiltered);
+
+    benchLog.setPrefix(printPrefix);
+    benchLog.setSuffix(printSuffix);
+    runBenchmark(F("prefix_suffix"), benchPrefixed);
+    benchLog.setPrefix(NULL);
+    benchLog.setSuffix(NULL);
+}
+
+void loop() {
+}
@@ -27,7 +27,8 @@ void setup() {
     //       this will significantly reduce your project size
 
     Log.begin(LOG_LEVEL_VERBOSE, &Serial);
-    //Log.setPrefix(printTimestamp); // Uncomment to get timestamps as prefix
+    //Log.setTimestamp(LOG_TIMESTAMP_UPTIME); // Uncomment to get timestamps as prefix
+    //Log.setPrefix(printTimestamp); // Uncomment to get a custom prefix
     //Log.setSuffix(printNewline); // Uncomment to get newline as suffix
 
     //Start logging
@@ -0,0 +1,292 @@
+#!/usr/bin/env python3
+"""
+Decoder for ArduinoLog binary records (LOG_BINARY_FORMAT).
+
+The sketch sends SLIP framed records that contain the address of the format
+string instead of the text. This tool reads the sketch's .elf file, looks the
+format strings up and prints the log lines as the text mode would have.
+
+    arduinolog_decode.py --elf sketch.ino.elf capture.bin
+    arduinolog_decode.py --elf sketch.ino.elf --port /dev/ttyUSB0 --baud 115200
+
+Reading from a serial port requires pyserial.
+"""
+
+import argparse
+import struct
+import sys
+from decimal import Decimal, ROUND_HALF_UP
+
+SLIP_END = 0xC0
+SLIP_ESC = 0xDB
+SLIP_ESC_END = 0xDC
+SLIP_ESC_ESC = 0xDD
+
+LEVELS = "FEWNTV"
+
+EM_AVR = 83
+AVR_RAM_OFFSET = 0x800000
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+
+class ElfImage:
+    """Minimal ELF reader mapping load addresses to section contents."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+        if data[:4] != b"\x7fELF":
+            raise ValueError("%s is not an ELF file" % path)
+        is64 = data[4] == 2
+        endian = "<" if data[5] == 1 else ">"
+        self.machine = struct.unpack_from(endian + "H", data, 18)[0]
+        if is64:
+            shoff, = struct.unpack_from(endian + "Q", data, 0x28)
+            shentsize, shnum = struct.unpack_from(endian + "HH", data, 0x3A)
+            fmt = endian + "IIQQQQ"
+        else:
+            shoff, = struct.unpack_from(endian + "I", data, 0x20)
+            shentsize, shnum = struct.unpack_from(endian + "HH", data, 0x2E)
+            fmt = endian + "IIIIII"
+        self.sections = []
+        for i in range(shnum):
+            _, sh_type, sh_flags, sh_addr, sh_offset, sh_size = \
+                struct.unpack_from(fmt, data, shoff + i * shentsize)
+            if sh_flags & SHF_ALLOC and sh_type != SHT_NOBITS and sh_size:
+                self.sections.append((sh_addr, data[sh_offset:sh_offset + sh_size]))
+
+    def string_at(self, address, flash):
+        candidates = [address]
+        if self.machine == EM_AVR and not flash:
+            candidates.insert(0, address | AVR_RAM_OFFSET)
+        for addr in candidates:
+            for start, content in self.sections:
+                if start <= addr < start + len(content):
+                    offset = addr - start
+                    end = content.find(b"\0", offset)
+                    if end < 0:
+                        end = len(content)
+                    return content[offset:end].decode("latin-1")
+        return None
+
+
+class Reader:
+    """Sequential reader over the unescaped payload of one record."""
+
+    def __init__(self, payload):
+        self.payload = payload
+        self.pos = 0
+
+    def take(self, n):
+        if self.pos + n > len(self.payload):
+            raise ValueError("record truncated")
+        chunk = self.payload[self.pos:self.pos + n]
+        self.pos += n
+        return chunk
+
+    def uint(self, n):
+        return int.from_bytes(self.take(n), "little")
+
+    def sint(self, n):
+        return int.from_bytes(self.take(n), "little", signed=True)
+
+    def string(self):
+        end = self.payload.find(b"\0", self.pos)
+        if end < 0:
+            raise ValueError("unterminated string argument")
+        s = self.payload[self.pos:end].decode("latin-1")
+        self.pos = end + 1
+        return s
+
+
+def hexdump_lines(data, width):
+    """Renders Log.hexdump() data the way the text mode prints it."""
+    lines = ["%d bytes\n" % len(data)]
+    for offset in range(0, len(data), width):
+        row = data[offset:offset + width]
+        hex_part = "".join("%02X " % b for b in row).ljust(3 * width)
+        text = "".join(chr(b) if 0x20 <= b < 0x7F else "." for b in row)
+        lines.append("%04X  %s %s\n" % (offset, hex_part, text))
+    return "".join(lines)
+
+
+def pad_number(text, width, pad):
+    """Pads like the logger: zeros go after the sign, spaces before it."""
+    if len(text) >= width:
+        return text
+    if pad == "0" and text.startswith("-"):
+        return "-" + text[1:].rjust(width - 1, "0")
+    return text.rjust(width, pad)
+
+
+def format_decimal(value, width, precision, pad):
+    """Formats %D/%F/%Q like the logger, which rounds half away from zero."""
+    if value != value:
+        return "nan"
+    if abs(value) > 4294967040.0:
+        return "inf" if value in (float("inf"), float("-inf")) else "ovf"
+    text = str(Decimal(value).quantize(Decimal(1).scaleb(-precision), rounding=ROUND_HALF_UP))
+    return pad_number(text, width, pad)
+
+
+def format_record(fmt, reader, int_size, hexdump_width=16, fixed_bits=16):
+    # %l and %u take 4 bytes, or 8 in a record whose integers are 8 bytes
+    long_size = max(int_size, 4)
+    out = []
+    i = 0
+    while i < len(fmt):
+        c = fmt[i]
+        i += 1
+        if c != "%":
+            out.append(c)
+            continue
+        if i >= len(fmt):
+            break
+        if fmt[i] == "%":
+            out.append("%")
+            i += 1
+            continue
+        pad = " "
+        if fmt[i] == "0":
+            pad = "0"
+            i += 1
+        width = 0
+        while i < len(fmt) and fmt[i].isdigit():
+            width = width * 10 + int(fmt[i])
+            i += 1
+        precision = 2
+        if i < len(fmt) and fmt[i] == ".":
+            i += 1
+            precision = 0
+            while i < len(fmt) and fmt[i].isdigit():
+                precision = precision * 10 + int(fmt[i])
+                i += 1
+            precision = min(precision, 9)
+        if i >= len(fmt):
+            break
+        spec = fmt[i]
+        i += 1
+        if spec in "sSP":
+            out.append(reader.string())
+        elif spec == "H":
+            out.append(hexdump_lines(reader.take(reader.uint(2)), hexdump_width))
+        elif spec == "I":
+            out.append(".".join(str(b) for b in reader.take(4)))
+        elif spec in "di":
+            out.append(pad_number(str(reader.sint(int_size)), width, pad))
+        elif spec in "xXbB":
+            value = reader.sint(int_size) & ((1 << (8 * long_size)) - 1)
+            if spec in "xX":
+                text = "%X" % value
+            else:
+                text = bin(value)[2:]
+            text = pad_number(text, width, pad)
+            if spec == "X":
+                text = "0x" + text
+            elif spec == "B":
+                text = "0b" + text
+            out.append(text)
+        elif spec == "l":
+            out.append(pad_number(str(reader.sint(long_size)), width, pad))
+        elif spec == "u":
+            out.append(pad_number(str(reader.uint(long_size)), width, pad))
+        elif spec in "DF":
+            value = struct.unpack("<f", reader.take(4))[0]
+            out.append(format_decimal(value, width, precision, pad))
+        elif spec == "Q":
+            value = reader.sint(4) / float(1 << fixed_bits)
+            out.append(format_decimal(value, width, precision, pad))
+        elif spec == "c":
+            out.append(chr(reader.uint(1)))
+        elif spec == "t":
+            out.append("T" if reader.uint(1) == 1 else "F")
+        elif spec == "T":
+            out.append("true" if reader.uint(1) == 1 else "false")
+    return "".join(out)
+
+
+def decode_frame(frame, elf, show_timestamp, hexdump_width=16, fixed_bits=16):
+    checksum = 0
+    for b in frame:
+        checksum ^= b
+    if checksum != 0:
+        raise ValueError("checksum mismatch")
+    reader = Reader(frame[:-1])
+    header = reader.uint(1)
+    level = header & 0x07
+    flash = bool(header & 0x08)
+    int_size = 8 if header & 0x80 else 2 if header & 0x10 else 4
+    ptr_size = 2 << ((header >> 5) & 0x03)
+    address = reader.uint(ptr_size)
+    timestamp = reader.uint(4)
+    fmt = elf.string_at(address, flash)
+    if fmt is None:
+        raise ValueError("no format string at 0x%X" % address)
+    text = format_record(fmt, reader, int_size, hexdump_width, fixed_bits)
+    prefix = LEVELS[level - 1] + ": " if 1 <= level <= len(LEVELS) else "?: "
+    if show_timestamp:
+        prefix = "%10u " % timestamp + prefix
+    return prefix + text
+
+
+def frames(stream):
+    """Yields unescaped SLIP frames; bytes before the first END are skipped."""
+    frame = None
+    escaped = False
+    while True:
+        chunk = stream.read(1)
+        if not chunk:
+            return
+        b = chunk[0]
+        if b == SLIP_END:
+            if frame:
+                yield bytes(frame)
+            frame = bytearray()
+            escaped = False
+        elif frame is None:
+            continue
+        elif escaped:
+            frame.append(SLIP_END if b == SLIP_ESC_END else SLIP_ESC if b == SLIP_ESC_ESC else b)
+            escaped = False
+        elif b == SLIP_ESC:
+            escaped = True
+        else:
+            frame.append(b)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode ArduinoLog binary records")
+    parser.add_argument("--elf", required=True, help="the sketch's .elf file")
+    parser.add_argument("input", nargs="?", help="captured log file (default: stdin)")
+    parser.add_argument("--port", help="read from a serial port instead (requires pyserial)")
+    parser.add_argument("--baud", type=int, default=115200, help="serial baud rate")
+    parser.add_argument("--no-timestamp", action="store_true", help="omit the millis() timestamp")
+    parser.add_argument("--hexdump-width", type=int, default=16, help="LOG_HEXDUMP_WIDTH of the sketch")
+    parser.add_argument("--fixed-bits", type=int, default=16, help="LOG_FIXED_POINT_BITS of the sketch")
+    args = parser.parse_args()
+
+    elf = ElfImage(args.elf)
+    if args.port:
+        import serial
+        stream = serial.Serial(args.port, args.baud)
+    elif args.input:
+        stream = open(args.input, "rb")
+    else:
+        stream = sys.stdin.buffer
+
+    for frame in frames(stream):
+        try:
+            line = decode_frame(frame, elf, not args.no_timestamp, args.hexdump_width, args.fixed_bits)
+        except ValueError as e:
+            sys.stderr.write("skipped record: %s\n" % e)
+            continue
+        sys.stdout.write(line)
+        if not line.endswith("\n"):
+            sys.stdout.write("\n")
+        sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""
+Decompressor for ArduinoLog compressed output (ArduinoLogCompress.h).
+
+LogCompressor sends every record as an LZSS compressed SLIP frame. This tool
+unpacks the frames and prints the log as the sketch would have printed it.
+After a lost or damaged frame the records up to the next window restart are
+skipped, since their matches may point into the lost data.
+
+    arduinolog_decompress.py capture.bin
+    arduinolog_decompress.py --port /dev/ttyUSB0 --baud 115200
+    arduinolog_decompress.py --udp 5000
+
+Reading from a serial port requires pyserial.
+"""
+
+import argparse
+import socket
+import sys
+
+from arduinolog_decode import LEVELS, frames
+
+MIN_MATCH = 3
+
+
+class Decompressor:
+    """Keeps the window across frames and unpacks one frame at a time."""
+
+    def __init__(self):
+        self.window = bytearray()
+        self.sequence = None
+        self.synced = False
+
+    def decode_frame(self, frame):
+        """Returns (level, text) or raises ValueError for a frame to skip."""
+        checksum = 0
+        for b in frame:
+            checksum ^= b
+        if len(frame) < 3 or checksum != 0:
+            self.synced = False
+            raise ValueError("checksum mismatch")
+        header, sequence = frame[0], frame[1]
+        level = header & 0x07
+        window_size = 1 << (header >> 4)
+        expected = self.sequence
+        self.sequence = (sequence + 1) & 0xFF
+        if header & 0x08:
+            self.window = bytearray()
+            self.synced = True
+        elif expected is not None and sequence != expected:
+            self.synced = False
+            raise ValueError("lost %d frames, waiting for a window restart" % ((sequence - expected) & 0xFF))
+        if not self.synced:
+            raise ValueError("waiting for a window restart")
+        try:
+            text = self.unpack(frame[2:-1], window_size)
+        except ValueError:
+            self.synced = False
+            raise
+        return level, text
+
+    def unpack(self, data, window_size):
+        out = bytearray()
+        history = self.window
+        i = 0
+        while i < len(data):
+            flags = data[i]
+            i += 1
+            for bit in range(8):
+                if i >= len(data):
+                    break
+                if flags & (1 << bit):
+                    if i + 2 > len(data):
+                        raise ValueError("match truncated")
+                    code = data[i] | (data[i + 1] >> 4) << 8
+                    length = (data[i + 1] & 0x0F) + MIN_MATCH
+                    i += 2
+                    distance = code + 1
+                    if distance > len(history) + len(out):
+                        raise ValueError("match before the start of the window")
+                    for _ in range(length):
+                        if distance > len(out):
+                            out.append(history[len(history) + len(out) - distance])
+                        else:
+                            out.append(out[-distance])
+                else:
+                    out.append(data[i])
+                    i += 1
+        self.window = (history + out)[-window_size:]
+        return out.decode("latin-1")
+
+
+class UdpStream:
+    """Makes received datagrams look like a byte stream for frames()."""
+
+    def __init__(self, port):
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.bind(("", port))
+        self.pending = b""
+
+    def read(self, n):
+        while not self.pending:
+            self.pending, _ = self.sock.recvfrom(65535)
+        chunk, self.pending = self.pending[:n], self.pending[n:]
+        return chunk
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decompress ArduinoLog compressed output")
+    parser.add_argument("input", nargs="?", help="captured log file (default: stdin)")
+    parser.add_argument("--port", help="read from a serial port instead (requires pyserial)")
+    parser.add_argument("--baud", type=int, default=115200, help="serial baud rate")
+    parser.add_argument("--udp", type=int, metavar="PORT", help="receive UDP datagrams on this port instead")
+    parser.add_argument("--show-level", action="store_true", help="prefix every record with its level")
+    args = parser.parse_args()
+
+    if args.udp:
+        stream = UdpStream(args.udp)
+    elif args.port:
+        import serial
+        stream = serial.Serial(args.port, args.baud)
+    elif args.input:
+        stream = open(args.input, "rb")
+    else:
+        stream = sys.stdin.buffer
+
+    decompressor = Decompressor()
+    for frame in frames(stream):
+        try:
+            level, text = decompressor.decode_frame(frame)
+        except ValueError as e:
+            sys.stderr.write("skipped record: %s\n" % e)
+            continue
+        if args.show_level and 1 <= level <= len(LEVELS):
+            text = LEVELS[level - 1] + ": " + text
+        sys.stdout.write(text)
+        sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
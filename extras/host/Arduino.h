@@ -0,0 +1,99 @@
+// Minimal Arduino core to build ArduinoLog on a desktop computer. It has only
+// what the library uses; define HOST_CUSTOM_CLOCK to provide millis()/micros().
+
+#ifndef LOGGING_HOST_ARDUINO_H
+#define LOGGING_HOST_ARDUINO_H
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(PSTR(s)))
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define constrain(x, low, high) ((x) < (low) ? (low) : ((x) > (high) ? (high) : (x)))
+enum { BIN = 2, OCT = 8, DEC = 10, HEX = 16 };
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+#ifdef HOST_CUSTOM_CLOCK
+unsigned long millis();
+unsigned long micros();
+#else
+#include <chrono>
+inline unsigned long micros() { using namespace std::chrono; return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count(); }
+inline unsigned long millis() { return micros() / 1000; }
+#endif
+
+typedef uint8_t byte;
+class __FlashStringHelper;
+class Print;
+
+struct Printable { virtual ~Printable() {} virtual size_t printTo(Print &p) const = 0; };
+
+class String
+{
+  public:
+    String(const char *s = "") : _s(strdup(s)) {}
+    String(const String &other) : _s(strdup(other._s)) {}
+    ~String() { free(_s); }
+    String &operator=(const String &other) { char *s = strdup(other._s); free(_s); _s = s; return *this; }
+    const char *c_str() const { return _s; }
+    unsigned int length() const { return strlen(_s); }
+  private:
+    char *_s;
+};
+
+class Print
+{
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *data, size_t size) { size_t n = 0; while (size-- > 0) n += write(*data++); return n; }
+    size_t write(const char *s) { return s != NULL ? write((const uint8_t *)s, strlen(s)) : 0; }
+    size_t write(const char *data, size_t size) { return write((const uint8_t *)data, size); }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const char *s) { return write(s); }
+    size_t print(const __FlashStringHelper *s) { return write(reinterpret_cast<const char *>(s)); }
+    size_t print(const String &s) { return write(s.c_str()); }
+    size_t print(const Printable &p) { return p.printTo(*this); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(int n, int base = DEC) { return print((long)n, base); }
+    size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(long n, int base = DEC) { return n < 0 && base == DEC ? print('-') + print((unsigned long)-n, base) : print((unsigned long)n, base); }
+    size_t print(unsigned long n, int base = DEC)
+    {
+      char text[8 * sizeof(long) + 1], *p = &text[sizeof(text) - 1];
+      for (*p = 0; p == &text[sizeof(text) - 1] || n > 0; n /= base) *--p = "0123456789ABCDEF"[n % base];
+      return write(p);
+    }
+    size_t print(double n, int digits = 2) { char text[32]; snprintf(text, sizeof(text), "%.*f", digits, n); return write(text); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T> size_t println(const T &value) { return print(value) + println(); }
+    template <typename T> size_t println(const T &value, int format) { return print(value, format) + println(); }
+};
+
+struct Stream : Print { virtual int available() = 0; virtual int read() = 0; virtual int peek() = 0; };
+
+class IPAddress : public Printable
+{
+  public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) { _a[0] = a; _a[1] = b; _a[2] = c; _a[3] = d; }
+    uint8_t operator[](int i) const { return _a[i]; }
+    uint8_t &operator[](int i) { return _a[i]; }
+    size_t printTo(Print &p) const { char text[16]; snprintf(text, sizeof(text), "%u.%u.%u.%u", _a[0], _a[1], _a[2], _a[3]); return p.write(text); }
+  private:
+    uint8_t _a[4];
+};
+#endif
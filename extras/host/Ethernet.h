@@ -0,0 +1,2 @@
+// ArduinoLog.h includes Ethernet.h for IPAddress, which Arduino.h has
+#include "Arduino.h"
@@ -0,0 +1,28 @@
+// Runs examples/Benchmark on the computer it is built on, printing the
+// same CSV as on the board. Build it with make in this directory.
+
+#include "Arduino.h"
+
+// Serial of the sketch, printing to stdout
+class HostSerial : public Stream
+{
+  public:
+    void begin(unsigned long) {}
+    operator bool() const { return true; }
+    int available() { return 0; }
+    int read() { return -1; }
+    int peek() { return -1; }
+    size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+    size_t write(const uint8_t *data, size_t size) { return fwrite(data, 1, size, stdout); }
+    using Print::write;
+};
+
+HostSerial Serial;
+
+#include "../../examples/Benchmark/Benchmark.ino"
+
+int main()
+{
+  setup();
+  return 0;
+}